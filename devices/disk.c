@@ -3,10 +3,15 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -32,6 +37,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -47,18 +53,122 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Largest block, in sectors, we ask for with SET MULTIPLE MODE. */
+#define MAX_MULTIPLE 16
+
+/* Bus master IDE registers, relative to the channel's bm_base. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master command register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Transfer from disk to memory. */
+
+/* Bus master status register bits. */
+#define BM_STA_ERR 0x02         /* Transfer failed (write 1 to clear). */
+#define BM_STA_INTR 0x04        /* Disk interrupted (write 1 to clear). */
+
+/* PCI configuration space access mechanism #1. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Physical region descriptor: one piece of a DMA transfer.  Pieces
+   must not cross a 64 kB boundary; we keep each within a page. */
+struct prd {
+	uint32_t addr;              /* Physical address. */
+	uint16_t size;              /* Size in bytes, 0 means 64 kB. */
+	uint16_t flags;             /* PRD_EOT on the last entry. */
+};
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Requests merged into one disk command at most. */
+#define MAX_BATCH 32
+
+/* How long, in timer ticks, a queued request may be passed over
+   in favor of higher classes or ones further along the elevator
+   sweep, indexed by class and then [0]=read [1]=write.  Reads have
+   a caller waiting, so they expire sooner.  These bound how long
+   best-effort and idle I/O can be starved. */
+static const int64_t deadlines[DISK_IOPRIO_CNT][2] = {
+	[DISK_IOPRIO_RT]   = { TIMER_FREQ / 50, TIMER_FREQ / 10 },
+	[DISK_IOPRIO_BE]   = { TIMER_FREQ / 20, TIMER_FREQ / 2 },
+	[DISK_IOPRIO_IDLE] = { TIMER_FREQ * 2, TIMER_FREQ * 5 },
+};
+
+/* Latency histogram buckets: bucket I counts requests that took
+   from 2**I to 2**(I+1) microseconds, bucket 0 anything faster. */
+#define LAT_BUCKETS 24
+
+/* Entries in the block trace ring. */
+#define TRACE_SIZE 256
+
+/* One completed request in the block trace ring. */
+struct trace_entry {
+	uint64_t time;              /* Completion, microseconds since boot. */
+	uint32_t latency;           /* Submit to completion, microseconds. */
+	disk_sector_t sector;       /* First sector. */
+	uint16_t cnt;               /* Number of sectors. */
+	char op;                    /* 'R' or 'W'. */
+	uint8_t prio;               /* enum disk_ioprio. */
+	uint8_t disk;               /* Channel * 2 + device. */
+	tid_t tid;                  /* Submitting thread. */
+};
+
+/* If true, disk_print_stats() also prints latency histograms,
+   queue depths, access patterns and the trace ring.  Set by the
+   "-disk-stats" kernel option. */
+bool disk_detailed_stats;
 
-/* An ATA device. */
+/* Most member disks a striped volume can have. */
+#define STRIPE_MAX 4
+
+/* Sectors per stripe unit: a page, so that a page-sized transfer
+   stays on one member while larger ones spread over all. */
+#define STRIPE_CHUNK (PGSIZE / DISK_SECTOR_SIZE)
+
+/* An ATA device, or a striped volume over several of them. */
 struct disk {
 	char name[8];               /* Name, e.g. "hd0:1". */
-	struct channel *channel;    /* Channel disk is on. */
+	struct channel *channel;    /* Channel disk is on, null if striped. */
 	int dev_no;                 /* Device 0 or 1 for master or slave. */
 
 	bool is_ata;                /* 1=This device is an ATA disk. */
 	disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+	int multiple;               /* Sectors per interrupt for READ/WRITE
+	                               MULTIPLE, or 0 if not enabled. */
+	bool dma;                   /* Transfer by bus master DMA? */
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
+
+	/* Statistics, guarded by the channel lock except lat_hist,
+	   which only the channel worker updates. */
+	uint32_t lat_hist[2][LAT_BUCKETS];  /* Latencies, [0]=read [1]=write. */
+	long long depth_sum;        /* Sum of queue depths seen on submit. */
+	long long depth_samples;    /* Number of depths summed. */
+	size_t depth_max;           /* Deepest queue seen on submit. */
+	long long seq_cnt;          /* Requests continuing the previous one. */
+	long long rand_cnt;         /* Requests that did not. */
+	disk_sector_t next_seq;     /* Sector after the previous request. */
+
+	/* Striped volume only. */
+	struct disk *members[STRIPE_MAX];   /* Member disks, in stripe order. */
+	size_t stripe_cnt;          /* Number of members, 0 if not striped. */
+};
+
+/* A request to a striped volume, split into one child request per
+   stripe unit it covers.  The parent completes with the last child. */
+struct stripe_io {
+	struct disk_request *parent;    /* Request to the volume. */
+	size_t pending;             /* Children not yet complete. */
+	struct disk_request children[]; /* Requests to the members. */
 };
 
 /* An ATA channel (aka controller).
@@ -67,8 +177,15 @@ struct channel {
 	char name[8];               /* Name, e.g. "hd0". */
 	uint16_t reg_base;          /* Base I/O port. */
 	uint8_t irq;                /* Interrupt in use. */
+	uint16_t bm_base;           /* Bus master I/O port, 0 if none. */
+	struct prd *prdt;           /* PRD table for DMA (if bm_base). */
+
+	struct lock lock;           /* Protects queue and head. */
+	struct list queue;          /* Pending struct disk_requests. */
+	size_t queue_len;           /* Number of requests in queue. */
+	struct condition queue_ready;   /* Signaled when queue is nonempty. */
+	uint64_t head;              /* Elevator position, see sweep_pos(). */
 
-	struct lock lock;           /* Must acquire to access the controller. */
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
 	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
@@ -84,7 +201,8 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t cnt);
+static void set_multiple_mode (struct disk *, int block);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -94,13 +212,25 @@ static bool wait_while_busy (const struct disk *);
 static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
+static uint16_t find_bus_master (void);
+static bool dma_transfer (struct disk_request **, size_t n, size_t cnt);
+static void pio_transfer (struct disk_request **, size_t n, size_t cnt);
+static void channel_worker (void *);
+static void calibrate_tsc (void);
+static uint64_t now_us (void);
+static void record_completion (struct disk_request *, uint64_t now);
+static void print_detailed_stats (const struct disk *);
+
 static void interrupt_handler (struct intr_frame *);
 
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) {
+	uint16_t bm_base = find_bus_master ();
 	size_t chan_no;
 
+	calibrate_tsc ();
+
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
 		struct channel *c = &channels[chan_no];
 		int dev_no;
@@ -119,7 +249,19 @@ disk_init (void) {
 			default:
 				NOT_REACHED ();
 		}
+		/* The primary channel's bus master registers come first. */
+		c->bm_base = 0;
+		c->prdt = NULL;
+		if (bm_base != 0) {
+			c->prdt = palloc_get_page (0);
+			if (c->prdt != NULL)
+				c->bm_base = bm_base + chan_no * 8;
+		}
 		lock_init (&c->lock);
+		list_init (&c->queue);
+		c->queue_len = 0;
+		cond_init (&c->queue_ready);
+		c->head = 0;
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
 
@@ -132,8 +274,15 @@ disk_init (void) {
 
 			d->is_ata = false;
 			d->capacity = 0;
+			d->multiple = 0;
+			d->dma = false;
 
 			d->read_cnt = d->write_cnt = 0;
+			memset (d->lat_hist, 0, sizeof d->lat_hist);
+			d->depth_sum = d->depth_samples = 0;
+			d->depth_max = 0;
+			d->seq_cnt = d->rand_cnt = 0;
+			d->next_seq = 0;
 		}
 
 		/* Register interrupt handler. */
@@ -150,6 +299,11 @@ disk_init (void) {
 		for (dev_no = 0; dev_no < 2; dev_no++)
 			if (c->devices[dev_no].is_ata)
 				identify_ata_device (&c->devices[dev_no]);
+
+		/* From here on, only the worker touches the controller, so
+		   both channels transfer at the same time. */
+		if (c->devices[0].is_ata || c->devices[1].is_ata)
+			thread_create (c->name, PRI_MAX, channel_worker, c);
 	}
 
 	/* DO NOT MODIFY BELOW LINES. */
@@ -166,11 +320,36 @@ disk_print_stats (void) {
 
 		for (dev_no = 0; dev_no < 2; dev_no++) {
 			struct disk *d = disk_get (chan_no, dev_no);
-			if (d != NULL && d->is_ata)
+			if (d != NULL && d->is_ata) {
 				printf ("%s: %lld reads, %lld writes\n",
 						d->name, d->read_cnt, d->write_cnt);
+				if (disk_detailed_stats)
+					print_detailed_stats (d);
+			}
 		}
 	}
+	if (disk_detailed_stats)
+		disk_dump_trace ();
+}
+
+/* Prints the latency histograms, queue depth and access pattern
+   of disk D. */
+static void
+print_detailed_stats (const struct disk *d) {
+	for (int w = 0; w < 2; w++) {
+		printf ("%s: %s latency (us):\n", d->name, w ? "write" : "read");
+		for (int i = 0; i < LAT_BUCKETS; i++)
+			if (d->lat_hist[w][i] != 0)
+				printf ("  [%8llu, %8llu): %"PRIu32"\n",
+						i == 0 ? 0ULL : 1ULL << i, 1ULL << (i + 1),
+						d->lat_hist[w][i]);
+	}
+	if (d->depth_samples > 0)
+		printf ("%s: queue depth avg %lld.%02lld, max %zu\n", d->name,
+				d->depth_sum / d->depth_samples,
+				d->depth_sum * 100 / d->depth_samples % 100, d->depth_max);
+	printf ("%s: %lld sequential, %lld random requests\n",
+			d->name, d->seq_cnt, d->rand_cnt);
 }
 
 /* Returns the disk numbered DEV_NO--either 0 or 1 for master or
@@ -204,6 +383,42 @@ disk_size (struct disk *d) {
 	return d->capacity;
 }
 
+/* Creates and returns a volume that stripes its sectors over the
+   CNT disks in MEMBERS, RAID-0 style: stripe units of STRIPE_CHUNK
+   sectors go to each member in turn.  A transfer spanning several
+   units is split among the members, whose channels work on their
+   parts at the same time, so members on different channels add up
+   their throughput.  The volume is as large as CNT times the
+   smallest member.  Returns a null pointer if out of memory. */
+struct disk *
+disk_stripe (struct disk *members[], size_t cnt) {
+	static int vol_cnt;
+	disk_sector_t member_size = (disk_sector_t) -1;
+	struct disk *d;
+
+	ASSERT (cnt >= 2 && cnt <= STRIPE_MAX);
+
+	d = calloc (1, sizeof *d);
+	if (d == NULL)
+		return NULL;
+	for (size_t i = 0; i < cnt; i++) {
+		ASSERT (members[i] != NULL && members[i]->channel != NULL);
+		if (members[i]->capacity < member_size)
+			member_size = members[i]->capacity;
+		d->members[i] = members[i];
+	}
+	d->stripe_cnt = cnt;
+	d->capacity = member_size / STRIPE_CHUNK * STRIPE_CHUNK * cnt;
+	d->is_ata = true;
+	snprintf (d->name, sizeof d->name, "md%d", vol_cnt++);
+
+	printf ("%s: striped over", d->name);
+	for (size_t i = 0; i < cnt; i++)
+		printf (" %s", members[i]->name);
+	printf (", %'"PRDSNu" sectors\n", d->capacity);
+	return d;
+}
+
 /* Reads sector SEC_NO from disk D into BUFFER, which must have
    room for DISK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to disks, so external
@@ -212,21 +427,7 @@ disk_size (struct disk *d) {
  * 내부적으로 디스크 접근 시 동기화를 진행하므로, 외부 locking을 필요로하지 않습니다.*/
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
-	struct channel *c;
-
-	ASSERT (d != NULL);
-	ASSERT (buffer != NULL);
-
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
-	lock_release (&c->lock);
+	disk_read_multi (d, sec_no, 1, buffer);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -239,24 +440,472 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
    디스크에 대한 액세스를 내부적으로 동기화하므로 외부 locking이 필요하지 않습니다.*/
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
+	disk_write_multi (d, sec_no, 1, buffer);
+}
+
+/* Completion function of the blocking calls: wakes the caller. */
+static void
+wake_waiter (struct disk_request *r) {
+	sema_up (r->aux);
+}
+
+/* Queues a request for CNT sectors at SEC_NO on disk D and waits
+   for it to complete. */
+static void
+transfer_wait (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		void *buffer, bool write) {
+	struct disk_request r;
+	struct semaphore done;
+
+	sema_init (&done, 0);
+	r.disk = d;
+	r.sector = sec_no;
+	r.cnt = cnt;
+	r.buffer = buffer;
+	r.write = write;
+	r.done = wake_waiter;
+	r.aux = &done;
+	disk_submit (&r);
+	sema_down (&done);
+}
+
+/* Reads CNT consecutive sectors, starting at SEC_NO, from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  CNT may be up to DISK_MAX_MULTI. */
+void
+disk_read_multi (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		void *buffer) {
+	transfer_wait (d, sec_no, cnt, buffer, false);
+}
+
+/* Writes CNT consecutive sectors, starting at SEC_NO, to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes.
+   CNT may be up to DISK_MAX_MULTI.  Returns after the disk has
+   acknowledged receiving all of the data. */
+void
+disk_write_multi (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		const void *buffer) {
+	transfer_wait (d, sec_no, cnt, (void *) buffer, true);
+}
+
+/* Completion function of a striped request's children: completes
+   the parent once every child is done.  Children finish on the
+   workers of different channels, so the count is updated with
+   interrupts off. */
+static void
+stripe_done (struct disk_request *child) {
+	struct stripe_io *io = child->aux;
+	struct disk_request *parent = io->parent;
+	enum intr_level old_level;
+	bool last;
+
+	old_level = intr_disable ();
+	last = --io->pending == 0;
+	intr_set_level (old_level);
+	if (last) {
+		free (io);
+		parent->done (parent);
+	}
+}
+
+/* Maps sector SEC_NO of striped volume D to a member, returned,
+   and the sector within it, stored in *MEMBER_SEC.  Stores in *CNT
+   how many sectors from SEC_NO on lie in the same stripe unit. */
+static struct disk *
+stripe_map (const struct disk *d, disk_sector_t sec_no,
+		disk_sector_t *member_sec, size_t *cnt) {
+	disk_sector_t unit = sec_no / STRIPE_CHUNK;
+	disk_sector_t ofs = sec_no % STRIPE_CHUNK;
+
+	*member_sec = unit / d->stripe_cnt * STRIPE_CHUNK + ofs;
+	*cnt = STRIPE_CHUNK - ofs;
+	return d->members[unit % d->stripe_cnt];
+}
+
+/* Splits request R to a striped volume into requests to its
+   members and submits them.  Out of memory, it transfers the pieces
+   one at a time instead and completes R before returning. */
+static void
+stripe_submit (struct disk_request *r) {
+	struct stripe_io *io;
+	disk_sector_t sec_no, member_sec;
+	size_t n, cnt, left;
+	uint8_t *buffer = r->buffer;
+
+	/* Stripe units covered. */
+	n = (r->sector + r->cnt - 1) / STRIPE_CHUNK - r->sector / STRIPE_CHUNK + 1;
+
+	io = malloc (sizeof *io + n * sizeof *io->children);
+	if (io == NULL) {
+		for (sec_no = r->sector, left = r->cnt; left > 0;
+				sec_no += cnt, left -= cnt) {
+			struct disk *m = stripe_map (r->disk, sec_no, &member_sec, &cnt);
+			if (cnt > left)
+				cnt = left;
+			transfer_wait (m, member_sec, cnt,
+					buffer + (sec_no - r->sector) * DISK_SECTOR_SIZE, r->write);
+		}
+		r->done (r);
+		return;
+	}
+
+	io->parent = r;
+	io->pending = n;
+	sec_no = r->sector;
+	left = r->cnt;
+	for (size_t i = 0; i < n; i++) {
+		struct disk_request *c = &io->children[i];
+
+		c->disk = stripe_map (r->disk, sec_no, &c->sector, &cnt);
+		c->cnt = cnt < left ? cnt : left;
+		c->buffer = buffer + (sec_no - r->sector) * DISK_SECTOR_SIZE;
+		c->write = r->write;
+		c->done = stripe_done;
+		c->aux = io;
+		sec_no += c->cnt;
+		left -= c->cnt;
+	}
+
+	/* IO may be freed as soon as the last child is queued. */
+	for (size_t i = 0; i < n; i++)
+		disk_submit (&io->children[i]);
+}
+
+/* Queues request R, whose disk, sector, cnt, buffer, write, done
+   and aux members the caller has set, and returns at once.  The
+   channel's worker calls R->done from its own thread once the
+   transfer is complete; until then R and its buffer must stay
+   valid.  R->cnt may be up to DISK_MAX_MULTI.  R is queued in the
+   I/O priority class of the running thread. */
+void
+disk_submit (struct disk_request *r) {
 	struct channel *c;
+	struct disk *d;
 
-	ASSERT (d != NULL);
-	ASSERT (buffer != NULL);
+	ASSERT (r != NULL);
+	ASSERT (r->disk != NULL);
+	ASSERT (r->buffer != NULL);
+	ASSERT (r->cnt > 0 && r->cnt <= DISK_MAX_MULTI);
+	ASSERT (r->sector + r->cnt <= r->disk->capacity);
+	ASSERT (r->done != NULL);
 
-	c = d->channel;
+	if (r->disk->stripe_cnt > 0) {
+		stripe_submit (r);
+		return;
+	}
+
+	c = r->disk->channel;
+	d = r->disk;
+	r->prio = disk_ioprio_current ();
+	r->deadline = timer_ticks () + deadlines[r->prio][r->write];
+	r->submit_time = now_us ();
+	r->tid = thread_current ()->tid;
 	lock_acquire (&c->lock);
-	/* disk's sector selection registers 에 sec_no 기록*/
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
+	d->depth_sum += c->queue_len;
+	d->depth_samples++;
+	if (c->queue_len > d->depth_max)
+		d->depth_max = c->queue_len;
+	if (r->sector == d->next_seq)
+		d->seq_cnt++;
+	else
+		d->rand_cnt++;
+	d->next_seq = r->sector + r->cnt;
+	list_push_back (&c->queue, &r->elem);
+	c->queue_len++;
+	cond_signal (&c->queue_ready, &c->lock);
 	lock_release (&c->lock);
 }
-
+
+/* Position of R on its channel's elevator: the sectors of the
+   slave sort after those of the master. */
+static uint64_t
+sweep_pos (const struct disk_request *r) {
+	return ((uint64_t) r->disk->dev_no << 32) | r->sector;
+}
+
+/* Returns the I/O priority class of the running thread.  It
+   follows the thread's nice value under the MLFQS scheduler and
+   its (possibly donated) priority otherwise, so that a thread
+   well above the default gets real-time I/O and one well below
+   gets idle I/O. */
+enum disk_ioprio
+disk_ioprio_current (void) {
+	struct thread *t = thread_current ();
+
+	if (thread_mlfqs) {
+		if (t->nice <= -10)
+			return DISK_IOPRIO_RT;
+		if (t->nice >= 10)
+			return DISK_IOPRIO_IDLE;
+	} else {
+		if (t->priority >= (PRI_DEFAULT + PRI_MAX) / 2)
+			return DISK_IOPRIO_RT;
+		if (t->priority <= (PRI_MIN + PRI_DEFAULT) / 2)
+			return DISK_IOPRIO_IDLE;
+	}
+	return DISK_IOPRIO_BE;
+}
+
+/* Picks the next request to serve from C's queue: the one whose
+   deadline passed longest ago, if any.  Otherwise, among the
+   requests of the highest class queued, the first at or past C's
+   head going up, wrapping to the lowest (C-SCAN).  Must be called
+   with C's lock held and the queue nonempty. */
+static struct disk_request *
+pick_request (struct channel *c) {
+	struct disk_request *expired = NULL, *next = NULL, *lowest = NULL;
+	enum disk_ioprio prio = DISK_IOPRIO_IDLE;
+	int64_t now = timer_ticks ();
+	struct list_elem *e;
+
+	for (e = list_begin (&c->queue); e != list_end (&c->queue); e = list_next (e)) {
+		struct disk_request *r = list_entry (e, struct disk_request, elem);
+
+		if (r->deadline <= now
+				&& (expired == NULL || r->deadline < expired->deadline))
+			expired = r;
+		if (r->prio < prio)
+			prio = r->prio;
+	}
+	if (expired != NULL)
+		return expired;
+
+	for (e = list_begin (&c->queue); e != list_end (&c->queue); e = list_next (e)) {
+		struct disk_request *r = list_entry (e, struct disk_request, elem);
+		uint64_t pos = sweep_pos (r);
+
+		if (r->prio != prio)
+			continue;
+		if (pos >= c->head && (next == NULL || pos < sweep_pos (next)))
+			next = r;
+		if (lowest == NULL || pos < sweep_pos (lowest))
+			lowest = r;
+	}
+	return next != NULL ? next : lowest;
+}
+
+/* Removes the next request from C's queue into BATCH[0], followed
+   by queued requests that continue it on disk in the same
+   direction, so that all of them take one command.  Returns the
+   number of requests and stores their total sectors in *CNT.
+   Must be called with C's lock held and the queue nonempty. */
+static size_t
+pick_batch (struct channel *c, struct disk_request *batch[], size_t *cnt) {
+	struct disk_request *first = pick_request (c);
+	size_t n = 1;
+	bool merged;
+
+	list_remove (&first->elem);
+	c->queue_len--;
+	batch[0] = first;
+	*cnt = first->cnt;
+	do {
+		struct list_elem *e;
+
+		merged = false;
+		for (e = list_begin (&c->queue);
+				e != list_end (&c->queue) && n < MAX_BATCH; e = list_next (e)) {
+			struct disk_request *r = list_entry (e, struct disk_request, elem);
+			if (r->disk == first->disk && r->write == first->write
+					&& r->sector == first->sector + *cnt
+					&& *cnt + r->cnt <= DISK_MAX_MULTI) {
+				list_remove (&r->elem);
+				c->queue_len--;
+				batch[n++] = r;
+				*cnt += r->cnt;
+				merged = true;
+				break;
+			}
+		}
+	} while (merged && n < MAX_BATCH);
+	c->head = sweep_pos (first) + *cnt;
+	return n;
+}
+
+/* Serves channel C's request queue forever. */
+static void
+channel_worker (void *c_) {
+	struct channel *c = c_;
+
+	for (;;) {
+		struct disk_request *batch[MAX_BATCH];
+		struct disk *d;
+		size_t n, cnt;
+		uint64_t now;
+
+		lock_acquire (&c->lock);
+		while (list_empty (&c->queue))
+			cond_wait (&c->queue_ready, &c->lock);
+		n = pick_batch (c, batch, &cnt);
+		lock_release (&c->lock);
+
+		d = batch[0]->disk;
+		if (!dma_transfer (batch, n, cnt))
+			pio_transfer (batch, n, cnt);
+		if (batch[0]->write)
+			d->write_cnt += cnt;
+		else
+			d->read_cnt += cnt;
+		now = now_us ();
+		for (size_t i = 0; i < n; i++) {
+			record_completion (batch[i], now);
+			batch[i]->done (batch[i]);
+		}
+	}
+}
+
+/* I/O statistics. */
+
+/* Time stamp counter cycles per microsecond. */
+static uint64_t tsc_per_us = 1;
+
+/* Block trace ring, most recent entry at trace_next - 1. */
+static struct trace_entry trace[TRACE_SIZE];
+static size_t trace_next;
+static size_t trace_cnt;
+static struct lock trace_lock;
+
+static inline uint64_t
+rdtsc (void) {
+	uint32_t lo, hi;
+	asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Measures the time stamp counter against one timer tick, so that
+   latencies can be reported in microseconds. */
+static void
+calibrate_tsc (void) {
+	int64_t start;
+	uint64_t t0;
+
+	lock_init (&trace_lock);
+
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		barrier ();
+	t0 = rdtsc ();
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		barrier ();
+	tsc_per_us = (rdtsc () - t0) * TIMER_FREQ / 1000000;
+	if (tsc_per_us == 0)
+		tsc_per_us = 1;
+}
+
+/* Returns microseconds since boot. */
+static uint64_t
+now_us (void) {
+	return rdtsc () / tsc_per_us;
+}
+
+/* Adds request R, completed at time NOW, to its disk's latency
+   histogram and to the trace ring.  Called by the channel
+   worker. */
+static void
+record_completion (struct disk_request *r, uint64_t now) {
+	uint64_t latency = now - r->submit_time;
+	struct trace_entry *t;
+	int bucket = 0;
+
+	while (bucket < LAT_BUCKETS - 1 && (latency >> (bucket + 1)) != 0)
+		bucket++;
+	r->disk->lat_hist[r->write][bucket]++;
+
+	lock_acquire (&trace_lock);
+	t = &trace[trace_next];
+	t->time = now;
+	t->latency = latency;
+	t->sector = r->sector;
+	t->cnt = r->cnt;
+	t->op = r->write ? 'W' : 'R';
+	t->prio = r->prio;
+	t->disk = (r->disk->channel - channels) * 2 + r->disk->dev_no;
+	t->tid = r->tid;
+	trace_next = (trace_next + 1) % TRACE_SIZE;
+	if (trace_cnt < TRACE_SIZE)
+		trace_cnt++;
+	lock_release (&trace_lock);
+}
+
+/* Prints the block trace ring, oldest entry first, to the
+   console, which includes the serial port. */
+void
+disk_dump_trace (void) {
+	size_t oldest;
+
+	lock_acquire (&trace_lock);
+	oldest = (trace_next + TRACE_SIZE - trace_cnt) % TRACE_SIZE;
+	printf ("disk trace: %zu most recent requests\n", trace_cnt);
+	printf ("%12s %8s %5s %2s %3s %10s %4s %5s\n", "time(us)", "lat(us)",
+			"disk", "op", "cls", "sector", "cnt", "tid");
+	for (size_t i = 0; i < trace_cnt; i++) {
+		struct trace_entry *t = &trace[(oldest + i) % TRACE_SIZE];
+		printf ("%12llu %8"PRIu32"   hd%d:%d %2c %3s %10"PRDSNu" %4u %5d\n",
+				(unsigned long long) t->time, t->latency,
+				t->disk / 2, t->disk % 2, t->op,
+				t->prio == DISK_IOPRIO_RT ? "rt"
+				: t->prio == DISK_IOPRIO_BE ? "be" : "idl",
+				t->sector, (unsigned) t->cnt, t->tid);
+	}
+	lock_release (&trace_lock);
+}
+
+/* Returns the buffer for the next sector of the N requests in
+   BATCH, advancing *REQ and *OFS, which start out as 0. */
+static uint8_t *
+next_sector_buf (struct disk_request **batch, size_t n UNUSED,
+		size_t *req, size_t *ofs) {
+	uint8_t *p;
+
+	ASSERT (*req < n);
+	p = (uint8_t *) batch[*req]->buffer + *ofs * DISK_SECTOR_SIZE;
+	if (++*ofs == batch[*req]->cnt) {
+		++*req;
+		*ofs = 0;
+	}
+	return p;
+}
+
+/* Moves the CNT sectors of the N back-to-back requests in BATCH
+   by PIO.  The whole batch is a single command; with multiple
+   mode enabled the disk interrupts once per block of sectors
+   instead of once per sector. */
+static void
+pio_transfer (struct disk_request **batch, size_t n, size_t cnt) {
+	struct disk *d = batch[0]->disk;
+	struct channel *c = d->channel;
+	bool write = batch[0]->write;
+	size_t block = 1, req = 0, ofs = 0;
+
+	select_sector (d, batch[0]->sector, cnt);
+	if (cnt > 1 && d->multiple > 1) {
+		block = d->multiple;
+		issue_pio_command (c, write ? CMD_WRITE_MULTIPLE : CMD_READ_MULTIPLE);
+	} else
+		issue_pio_command (c, write ? CMD_WRITE_SECTOR_RETRY
+				: CMD_READ_SECTOR_RETRY);
+	for (size_t done = 0; done < cnt; done += block) {
+		size_t blk = cnt - done < block ? cnt - done : block;
+
+		if (!write)
+			sema_down (&c->completion_wait);
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk %s failed, sector=%"PRDSNu, d->name,
+					write ? "write" : "read",
+					(disk_sector_t) (batch[0]->sector + done));
+		for (size_t i = 0; i < blk; i++) {
+			uint8_t *p = next_sector_buf (batch, n, &req, &ofs);
+			if (write)
+				output_sector (c, p);
+			else
+				input_sector (c, p);
+		}
+		if (write)
+			sema_down (&c->completion_wait);
+	}
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -371,6 +1020,14 @@ identify_ata_device (struct disk *d) {
 	/* Calculate capacity. */
 	d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
+	/* Word 47 gives the largest block READ/WRITE MULTIPLE supports. */
+	if ((id[47] & 0xff) > 1)
+		set_multiple_mode (d, (id[47] & 0xff) < MAX_MULTIPLE
+				? (id[47] & 0xff) : MAX_MULTIPLE);
+
+	/* Word 49 bit 8 says the disk can do DMA. */
+	d->dma = c->bm_base != 0 && (id[49] & 0x100) != 0;
+
 	/* Print identification message. */
 	printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
 	if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
@@ -389,6 +1046,144 @@ identify_ata_device (struct disk *d) {
 	printf ("\"\n");
 }
 
+/* Asks disk D to transfer BLOCK sectors per interrupt in READ/WRITE
+   MULTIPLE, and records the block size if the disk accepts it.
+   Multi-sector transfers fall back to one interrupt per sector
+   otherwise. */
+static void
+set_multiple_mode (struct disk *d, int block) {
+	struct channel *c = d->channel;
+
+	select_device_wait (d);
+	outb (reg_nsect (c), block);
+	issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+	sema_down (&c->completion_wait);
+	wait_while_busy (d);
+	if ((inb (reg_status (c)) & STA_ERR) == 0)
+		d->multiple = block;
+}
+
+/* Bus master DMA. */
+
+/* Reads 32-bit register REG of PCI function BUS:DEV.FN. */
+static uint32_t
+pci_read (int bus, int dev, int fn, int reg) {
+	outl (PCI_CONFIG_ADDR, 0x80000000 | (bus << 16) | (dev << 11)
+			| (fn << 8) | (reg & 0xfc));
+	return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to 32-bit register REG of PCI function BUS:DEV.FN. */
+static void
+pci_write (int bus, int dev, int fn, int reg, uint32_t value) {
+	outl (PCI_CONFIG_ADDR, 0x80000000 | (bus << 16) | (dev << 11)
+			| (fn << 8) | (reg & 0xfc));
+	outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0 for an IDE controller, such as the PIIX that
+   QEMU emulates, that drives the legacy channels and can master
+   the bus.  Enables bus mastering on it and returns the I/O port
+   of its bus master registers, or 0 if there is none, in which
+   case all transfers use PIO. */
+static uint16_t
+find_bus_master (void) {
+	for (int dev = 0; dev < 32; dev++)
+		for (int fn = 0; fn < 8; fn++) {
+			uint32_t class, bar;
+
+			if ((pci_read (0, dev, fn, 0x00) & 0xffff) == 0xffff)
+				continue;
+
+			/* Mass storage, IDE, legacy ports, bus master capable. */
+			class = pci_read (0, dev, fn, 0x08);
+			if ((class >> 16) != 0x0101 || (class & 0x8500) != 0x8000)
+				continue;
+
+			bar = pci_read (0, dev, fn, 0x20);
+			if ((bar & 1) == 0 || (bar & 0xfffc) == 0)
+				continue;
+
+			/* Enable I/O space and bus mastering. */
+			pci_write (0, dev, fn, 0x04, pci_read (0, dev, fn, 0x04) | 0x05);
+			return bar & 0xfffc;
+		}
+	return 0;
+}
+
+/* Appends entries covering the SIZE bytes at BUFFER to the PRD
+   table PRDT, which holds *N entries so far.  Returns false if
+   BUFFER cannot be reached by DMA: it is not mapped in the
+   kernel's linear view of physical memory, is not word aligned,
+   or lies above 4 GB. */
+static bool
+add_prds (struct prd *prdt, size_t *n, const void *buffer, size_t size) {
+	const uint8_t *p = buffer;
+
+	if (!is_kernel_vaddr (buffer) || ((uintptr_t) buffer & 1) != 0)
+		return false;
+	while (size > 0) {
+		size_t chunk = PGSIZE - pg_ofs (p);
+		uint64_t pa = vtop (p);
+
+		if (chunk > size)
+			chunk = size;
+		if (pa + chunk > 0x100000000ULL)
+			return false;
+		prdt[*n].addr = pa;
+		prdt[*n].size = chunk;
+		prdt[*n].flags = 0;
+		++*n;
+		p += chunk;
+		size -= chunk;
+	}
+	return true;
+}
+
+/* Moves the CNT sectors of the N back-to-back requests in BATCH by
+   bus master DMA, one command scattering across their buffers.
+   The CPU is free for other threads until the completion
+   interrupt.  Returns false, having moved nothing, if the disk or
+   a buffer cannot use DMA; the caller then falls back to PIO.  A
+   DMA error disables DMA on the disk for good. */
+static bool
+dma_transfer (struct disk_request **batch, size_t n, size_t cnt) {
+	struct disk *d = batch[0]->disk;
+	struct channel *c = d->channel;
+	bool write = batch[0]->write;
+	uint8_t dir = write ? 0 : BM_CMD_READ;
+	size_t prd_cnt = 0;
+	uint8_t status;
+
+	if (!d->dma)
+		return false;
+	for (size_t i = 0; i < n; i++)
+		if (!add_prds (c->prdt, &prd_cnt, batch[i]->buffer,
+					batch[i]->cnt * DISK_SECTOR_SIZE))
+			return false;
+	c->prdt[prd_cnt - 1].flags = PRD_EOT;
+
+	outl (reg_bm_prdt (c), vtop (c->prdt));
+	outb (reg_bm_command (c), dir);
+	outb (reg_bm_status (c), inb (reg_bm_status (c)) | BM_STA_ERR | BM_STA_INTR);
+
+	select_sector (d, batch[0]->sector, cnt);
+	issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+	outb (reg_bm_command (c), dir | BM_CMD_START);
+	sema_down (&c->completion_wait);
+	outb (reg_bm_command (c), dir);
+
+	status = inb (reg_bm_status (c));
+	outb (reg_bm_status (c), status | BM_STA_ERR | BM_STA_INTR);
+	if ((status & BM_STA_ERR) != 0 || (inb (reg_status (c)) & STA_ERR) != 0) {
+		printf ("%s: DMA failed, sector=%"PRDSNu", using PIO\n",
+				d->name, batch[0]->sector);
+		d->dma = false;
+		return false;
+	}
+	return true;
+}
+
 /* Prints STRING, which consists of SIZE bytes in a funky format:
    each pair of bytes is in reverse order.  Does not print
    trailing whitespace and/or nulls. */
@@ -409,17 +1204,19 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the sector count CNT to the disk's sector
+   selection registers.  (We use LBA mode.)  A count register of 0
+   means 256 sectors. */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (cnt > 0 && cnt <= DISK_MAX_MULTI);
+	ASSERT (sec_no + cnt <= d->capacity);
+	ASSERT (sec_no + cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt & 0xff);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
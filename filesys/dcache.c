@@ -0,0 +1,192 @@
+/* dcache.c: Cache of path component lookups.
+ *
+ * Maps (parent directory inode sector, name) to the sector of the
+ * child inode, so that walking a path that was resolved before does
+ * not have to open and scan every directory on the way.  Lookups that
+ * failed are remembered as negative entries, so repeatedly probing for
+ * a missing name is just as cheap.
+ *
+ * The directory layer keeps the cache coherent: dir_add() and
+ * dir_remove() invalidate the (parent, name) pair they change, and
+ * the entries of a directory are purged when its inode is freed. */
+
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Maximum number of cached entries.  The least recently used entry
+ * is evicted when the cache is full. */
+#define DCACHE_SIZE 256
+
+struct dcache_entry {
+	struct hash_elem hash_elem;         /* Element in dcache_map. */
+	struct list_elem lru_elem;          /* Element in dcache_lru. */
+	disk_sector_t parent;               /* Inode sector of the directory. */
+	char name[NAME_MAX + 1];            /* Component name. */
+	bool negative;                      /* True if NAME does not exist. */
+	disk_sector_t sector;               /* Child inode sector. */
+	bool is_dir;                        /* Child is a directory? */
+};
+
+static struct hash dcache_map;
+static struct list dcache_lru;          /* Most recently used at front. */
+static struct lock dcache_lock;
+
+static uint64_t
+dcache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dcache_entry *de = hash_entry (e, struct dcache_entry, hash_elem);
+	return hash_string (de->name) ^ hash_int (de->parent);
+}
+
+static bool
+dcache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dcache_entry *a = hash_entry (a_, struct dcache_entry, hash_elem);
+	const struct dcache_entry *b = hash_entry (b_, struct dcache_entry, hash_elem);
+	if (a->parent != b->parent)
+		return a->parent < b->parent;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void) {
+	hash_init (&dcache_map, dcache_hash, dcache_less, NULL);
+	list_init (&dcache_lru);
+	lock_init (&dcache_lock);
+}
+
+/* Returns the entry for (PARENT, NAME), or a null pointer.
+ * Must be called with dcache_lock held. */
+static struct dcache_entry *
+find_entry (disk_sector_t parent, const char *name) {
+	struct dcache_entry key;
+	struct hash_elem *e;
+
+	key.parent = parent;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&dcache_map, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct dcache_entry, hash_elem) : NULL;
+}
+
+/* Unlinks DE from the cache and frees it.
+ * Must be called with dcache_lock held. */
+static void
+drop_entry (struct dcache_entry *de) {
+	hash_delete (&dcache_map, &de->hash_elem);
+	list_remove (&de->lru_elem);
+	free (de);
+}
+
+/* Looks up NAME in the directory whose inode is at PARENT.
+ * On a positive hit, stores the child's inode sector in *SECTORP and
+ * whether it is a directory in *IS_DIRP (either may be null). */
+enum dcache_result
+dcache_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp, bool *is_dirp) {
+	struct dcache_entry *de;
+	enum dcache_result result = DCACHE_MISS;
+
+	if (strlen (name) > NAME_MAX)
+		return DCACHE_MISS;
+
+	lock_acquire (&dcache_lock);
+	de = find_entry (parent, name);
+	if (de != NULL) {
+		list_remove (&de->lru_elem);
+		list_push_front (&dcache_lru, &de->lru_elem);
+		if (de->negative)
+			result = DCACHE_NEGATIVE;
+		else {
+			if (sectorp != NULL)
+				*sectorp = de->sector;
+			if (is_dirp != NULL)
+				*is_dirp = de->is_dir;
+			result = DCACHE_POSITIVE;
+		}
+	}
+	lock_release (&dcache_lock);
+	return result;
+}
+
+/* Records (PARENT, NAME), replacing any previous entry for it. */
+static void
+insert (disk_sector_t parent, const char *name, bool negative,
+		disk_sector_t sector, bool is_dir) {
+	struct dcache_entry *de;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	de = find_entry (parent, name);
+	if (de != NULL)
+		list_remove (&de->lru_elem);
+	else {
+		if (hash_size (&dcache_map) >= DCACHE_SIZE)
+			drop_entry (list_entry (list_back (&dcache_lru),
+						struct dcache_entry, lru_elem));
+		de = malloc (sizeof *de);
+		if (de == NULL) {
+			lock_release (&dcache_lock);
+			return;
+		}
+		de->parent = parent;
+		strlcpy (de->name, name, sizeof de->name);
+		hash_insert (&dcache_map, &de->hash_elem);
+	}
+	de->negative = negative;
+	de->sector = sector;
+	de->is_dir = is_dir;
+	list_push_front (&dcache_lru, &de->lru_elem);
+	lock_release (&dcache_lock);
+}
+
+/* Remembers that NAME in PARENT refers to the inode at SECTOR. */
+void
+dcache_insert (disk_sector_t parent, const char *name,
+		disk_sector_t sector, bool is_dir) {
+	insert (parent, name, false, sector, is_dir);
+}
+
+/* Remembers that PARENT has no entry named NAME. */
+void
+dcache_insert_negative (disk_sector_t parent, const char *name) {
+	insert (parent, name, true, 0, false);
+}
+
+/* Forgets whatever is cached for NAME in PARENT. */
+void
+dcache_invalidate (disk_sector_t parent, const char *name) {
+	struct dcache_entry *de;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	de = find_entry (parent, name);
+	if (de != NULL)
+		drop_entry (de);
+	lock_release (&dcache_lock);
+}
+
+/* Forgets every entry of the directory at PARENT.  Called when the
+ * directory's inode is freed, since its sector may be reused. */
+void
+dcache_purge (disk_sector_t parent) {
+	struct list_elem *e;
+
+	lock_acquire (&dcache_lock);
+	for (e = list_begin (&dcache_lru); e != list_end (&dcache_lru);) {
+		struct dcache_entry *de = list_entry (e, struct dcache_entry, lru_elem);
+		e = list_next (e);
+		if (de->parent == parent)
+			drop_entry (de);
+	}
+	lock_release (&dcache_lock);
+}
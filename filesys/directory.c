@@ -5,9 +5,11 @@
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /*project 4*/
 #include "filesys/fat.h"
+#include "filesys/dcache.h"
 
 /* A directory. */
 // /* 디렉토리 구조체 */
@@ -119,18 +121,69 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
 	struct dir_entry e;
+	disk_sector_t parent, sector;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open(e.inode_sector);
-	else
-		*inode = NULL;
+	*inode = NULL;
+	parent = inode_get_inumber (dir->inode);
+	lock_acquire (&dir->inode->dir_lock);
+	switch (dcache_lookup (parent, name, &sector, NULL)) {
+		case DCACHE_POSITIVE:
+			*inode = inode_open (sector);
+			break;
+		case DCACHE_NEGATIVE:
+			break;
+		case DCACHE_MISS:
+			if (lookup (dir, name, &e, NULL)) {
+				*inode = inode_open (e.inode_sector);
+				if (*inode != NULL)
+					dcache_insert (parent, name, e.inode_sector,
+							inode_is_dir (*inode));
+			} else
+				dcache_insert_negative (parent, name);
+			break;
+	}
+	lock_release (&dir->inode->dir_lock);
 
 	return *inode != NULL;
 }
 
+/* Searches the directory whose inode is at PARENT for NAME, without
+ * opening the child.  On success, stores the child's inode sector in
+ * *SECTORP and whether it is a directory in *IS_DIRP.  Served from
+ * the dcache when possible, so walking a path that was resolved
+ * before does no disk I/O. */
+bool
+dir_lookup_sector (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp, bool *is_dirp) {
+	struct dir *dir;
+	struct inode *inode;
+
+	switch (dcache_lookup (parent, name, sectorp, is_dirp)) {
+		case DCACHE_POSITIVE:
+			return true;
+		case DCACHE_NEGATIVE:
+			return false;
+		case DCACHE_MISS:
+			break;
+	}
+
+	dir = dir_open (inode_open (parent));
+	if (dir == NULL)
+		return false;
+	if (!dir_lookup (dir, name, &inode)) {
+		dir_close (dir);
+		return false;
+	}
+	*sectorp = inode_get_inumber (inode);
+	*is_dirp = inode_is_dir (inode);
+	inode_close (inode);
+	dir_close (dir);
+	return true;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
  * file by that name.  The file's inode is in sector
  * INODE_SECTOR.
@@ -149,6 +202,8 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
+	lock_acquire (&dir->inode->dir_lock);
+
 	/* Check that NAME is not in use. */
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
@@ -170,8 +225,10 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	strlcpy (e.name, name, sizeof e.name);
 	e.inode_sector = inode_sector;
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+	dcache_invalidate (inode_get_inumber (dir->inode), name);
 
 done:
+	lock_release (&dir->inode->dir_lock);
 	return success;
 }
 
@@ -192,6 +249,7 @@ dir_remove (struct dir *dir, const char *name) {
         return false;
     }
 
+	lock_acquire (&dir->inode->dir_lock);
 
 	/* Find directory entry. */
 	if (!lookup (dir, name, &e, &ofs))
@@ -206,12 +264,14 @@ dir_remove (struct dir *dir, const char *name) {
 	e.in_use = false;
 	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
 		goto done;
+	dcache_invalidate (inode_get_inumber (dir->inode), name);
 
 	/* Remove inode. */
 	inode_remove (inode);
 	success = true;
 
 done:
+	lock_release (&dir->inode->dir_lock);
 	inode_close (inode);
 	return success;
 }
@@ -235,6 +295,69 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	return false;
 }
 
+/* Number of directory entries dir_getdents() reads at a time. */
+#define GETDENTS_BATCH 64
+
+/* Returns whether ENTRY of DIR names a directory, from the dcache if
+ * possible, otherwise by opening its inode and caching the answer.
+ * DIR's dir_lock must be held, so that ENTRY is still in use. */
+static bool
+entry_is_dir (const struct dir *dir, const struct dir_entry *e) {
+	disk_sector_t parent = inode_get_inumber (dir->inode);
+	struct inode *inode;
+	bool is_dir;
+
+	if (dcache_lookup (parent, e->name, NULL, &is_dir) == DCACHE_POSITIVE)
+		return is_dir;
+	inode = inode_open (e->inode_sector);
+	if (inode == NULL)
+		return false;
+	is_dir = inode_is_dir (inode);
+	inode_close (inode);
+	dcache_insert (parent, e->name, e->inode_sector, is_dir);
+	return is_dir;
+}
+
+/* Stores up to CNT entries of DIR, from its current position on, in
+ * ENTS, advancing the position past them.  Entries are read many at
+ * a time rather than one by one, each batch under DIR's dir_lock so
+ * that none of its entries is removed before it is stored.  Returns
+ * the number of entries stored, 0 at the end of DIR. */
+size_t
+dir_getdents (struct dir *dir, struct dirent *ents, size_t cnt) {
+	struct dir_entry *batch;
+	size_t n = 0;
+
+	ASSERT (dir != NULL);
+
+	batch = malloc (GETDENTS_BATCH * sizeof *batch);
+	if (batch == NULL)
+		return 0;
+	while (n < cnt) {
+		size_t want = cnt - n < GETDENTS_BATCH ? cnt - n : GETDENTS_BATCH;
+		size_t got;
+
+		lock_acquire (&dir->inode->dir_lock);
+		got = inode_read_at (dir->inode, batch, want * sizeof *batch,
+				dir->pos) / sizeof *batch;
+
+		for (size_t i = 0; i < got && n < cnt; i++) {
+			dir->pos += sizeof *batch;
+			if (!batch[i].in_use)
+				continue;
+			ents[n].d_ino = batch[i].inode_sector;
+			ents[n].d_type = entry_is_dir (dir, &batch[i]) ? DT_DIR : DT_REG;
+			strlcpy (ents[n].d_name, batch[i].name, sizeof ents[n].d_name);
+			n++;
+		}
+		lock_release (&dir->inode->dir_lock);
+		if (got < want)
+			break;
+	}
+	free (batch);
+	return n;
+}
+
 void dir_seek(struct dir *dir, off_t new_pos) {
 	ASSERT(dir != NULL);
 	ASSERT(new_pos >= 0);
@@ -1,35 +1,94 @@
 #include "filesys/fat.h"
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/journal.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include <hash.h>
 #include <stdio.h>
 #include <string.h>
 
+/* How often the background flusher writes dirty FAT sectors. */
+#define FAT_FLUSH_INTERVAL TIMER_FREQ
+
+/* FAT entries per FAT sector. */
+#define FAT_ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (cluster_t))
+
+/* FAT sectors fat_create() zeroes per disk command. */
+#define FAT_ZERO_CNT (PGSIZE / DISK_SECTOR_SIZE)
+
+/* If true, FAT changes are written to disk before the allocating or
+ * freeing call returns, so no inode or directory that reaches the
+ * disk ever refers to a cluster the on-disk FAT does not know about.
+ * Set by the "-fat-ordered" kernel option. */
+bool fat_ordered_writes;
+
+/* Sectors per cluster used by fat_create().  A disk that is already
+ * formatted keeps the cluster size recorded in its boot sector. */
+unsigned int fat_format_cluster_size = SECTORS_PER_CLUSTER;
+
 /* Should be less than DISK_SECTOR_SIZE */
 struct fat_boot {
 	unsigned int magic;
-	unsigned int sectors_per_cluster; /* Fixed to 1 */
+	unsigned int sectors_per_cluster; /* 1 to MAX_SECTORS_PER_CLUSTER */
 	unsigned int total_sectors;	//20,160개 (9.84MB)
 	unsigned int fat_start;	//1
 	unsigned int fat_sectors; /* Size of FAT in sectors. 157섹터(FAT자체의 크기)*/ 
 	unsigned int root_dir_cluster;
+	unsigned int journal_sectors; /* Journal region after the FAT, or 0. */
+	unsigned int free_clusters; /* Data clusters not in any chain. */
+	unsigned int used_inodes;	/* Inodes of files and directories. */
+	unsigned int counts_magic;	/* FAT_COUNTS_MAGIC if the two above are
+								   up to date on disk. */
+};
+
+/* Marks the boot sector's counters as valid.  Without a journal it is
+ * written only at a clean shutdown, so a crash leaves it clear and the
+ * next mount counts again. */
+#define FAT_COUNTS_MAGIC 0x434e5453
+
+/* One FAT sector held in memory. */
+struct fat_block {
+	struct hash_elem elem;		/* Element in fat_fs->blocks. */
+	unsigned int idx;			/* Which FAT sector, from 0. */
+	bool in_use;				/* Holds a FAT sector at all? */
+	bool dirty;					/* Differs from the disk copy? */
+	bool accessed;				/* Used since the clock hand passed? */
+	cluster_t entries[FAT_ENTRIES_PER_SECTOR];
 };
 
-/* FAT FS */
+/* FAT FS
+ * The FAT itself is not kept in memory.  FAT sectors are read on
+ * first use into a fixed cache of FAT_CACHE_SIZE blocks, and evicted
+ * in clock order, written back first if dirty. */
 struct fat_fs {
 	struct fat_boot bs;			//부팅 시 FAT 정보를 담는 구조체
-	unsigned int *fat;			//FAT array
 	unsigned int fat_length;	//20096 파일 시스템에 있는 클러스터 수
 	disk_sector_t data_start;	//파일을 저장하기 위한 시작섹터번호
 	cluster_t last_clst;		//마지막 클러스터
-	struct lock write_lock;		
+	struct lock write_lock;		/* Guards the cache and all entries. */
+	struct fat_block *cache;	/* FAT_CACHE_SIZE blocks. */
+	struct hash blocks;			/* In-use blocks, by idx. */
+	size_t clock_hand;			/* Next eviction candidate. */
+	bool boot_dirty;			/* Counters changed since last written? */
+	bool inodes_unknown;		/* used_inodes must be counted again? */
 };
 
 static struct fat_fs *fat_fs;
 
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_flushd (void *aux);
+static cluster_t fat_cluster_limit (void);
+static cluster_t entry_get (cluster_t clst);
+static void write_boot (bool clean);
+static void recount_free (void);
+static uint64_t block_hash (const struct hash_elem *, void *);
+static bool block_less (const struct hash_elem *, const struct hash_elem *,
+		void *);
 
 /* FAT 테이블 초기화하는 함수 */
 void
@@ -54,65 +113,184 @@ fat_init (void) {
 	fat_fs_init ();
 }
 
+/* Mounts the FAT.  FAT sectors are loaded as they are first used;
+ * only the boot sector's counters are read again, since replaying the
+ * journal may have updated them.  If they were not saved cleanly, the
+ * free clusters are counted now and used inodes are left for
+ * filesys_init() to count, see fat_inodes_unknown(). */
 void
 fat_open (void) {
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT load failed");
-
-	// Load FAT directly from the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
+	struct fat_boot *bs = malloc (DISK_SECTOR_SIZE);
+
+	if (bs == NULL)
+		PANIC ("FAT open failed");
+	journal_read (FAT_BOOT_SECTOR, bs);
+	if (bs->magic == FAT_MAGIC) {
+		fat_fs->bs.free_clusters = bs->free_clusters;
+		fat_fs->bs.used_inodes = bs->used_inodes;
+		fat_fs->bs.counts_magic = bs->counts_magic;
+	}
+	free (bs);
+
+	if (fat_fs->bs.counts_magic != FAT_COUNTS_MAGIC) {
+		recount_free ();
+		fat_fs->bs.used_inodes = 0;
+		fat_fs->bs.counts_magic = FAT_COUNTS_MAGIC;
+		fat_fs->inodes_unknown = true;
 	}
+
+	/* On disk, the counters stay invalid until fat_close(). */
+	lock_acquire (&fat_fs->write_lock);
+	write_boot (false);
+	lock_release (&fat_fs->write_lock);
+
+	thread_create ("fat_flushd", PRI_DEFAULT, fat_flushd, NULL);
 }
 
 void
 fat_close (void) {
-	// Write FAT boot sector
-	uint8_t *bounce = calloc (1, DISK_SECTOR_SIZE);
-	if (bounce == NULL)
-		PANIC ("FAT close failed");
-	memcpy (bounce, &fat_fs->bs, sizeof (fat_fs->bs));
-	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
-	free (bounce);
+	// Write only the FAT sectors that changed
+	fat_flush ();
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
+	// Write FAT boot sector, counters marked valid
+	lock_acquire (&fat_fs->write_lock);
+	write_boot (true);
+	lock_release (&fat_fs->write_lock);
+	journal_commit ();
+}
+
+/* Writes the boot sector, through the journal like the FAT.  Its
+ * counters are marked valid if CLEAN, or if the journal commits them
+ * together with the FAT sectors they describe.  Must be called with
+ * write_lock held. */
+static void
+write_boot (bool clean) {
+	static uint8_t sector[DISK_SECTOR_SIZE];
+	struct fat_boot *bs = (struct fat_boot *) sector;
+
+	ASSERT (lock_held_by_current_thread (&fat_fs->write_lock));
+
+	*bs = fat_fs->bs;
+	if (!clean && !journal_enabled ())
+		bs->counts_magic = 0;
+	journal_write (FAT_BOOT_SECTOR, sector);
+	fat_fs->boot_dirty = false;
+}
+
+/* Counts the free clusters by scanning the whole FAT.  Only needed
+ * when the counters on disk are missing or stale. */
+static void
+recount_free (void) {
+	const cluster_t limit = fat_cluster_limit ();
+	unsigned int cnt = 0;
+
+	lock_acquire (&fat_fs->write_lock);
+	for (cluster_t i = fat_fs->bs.fat_start + 1; i < limit; i++)
+		if (entry_get (i) == 0)
+			cnt++;
+	fat_fs->bs.free_clusters = cnt;
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Returns true if the number of inodes in use was lost, so the
+ * caller must count them and report them with fat_count_inode(). */
+bool
+fat_inodes_unknown (void) {
+	return fat_fs->inodes_unknown;
+}
+
+/* Adds DELTA to the number of inodes in use. */
+void
+fat_count_inode (int delta) {
+	lock_acquire (&fat_fs->write_lock);
+	fat_fs->bs.used_inodes += delta;
+	fat_fs->boot_dirty = true;
+	fat_fs->inodes_unknown = false;
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Fills ST with the file system's size and usage, from counters kept
+ * up to date as clusters and inodes are allocated and freed. */
+void
+fat_statfs (struct statfs *st) {
+	lock_acquire (&fat_fs->write_lock);
+	st->f_bsize = fat_fs->bs.sectors_per_cluster * DISK_SECTOR_SIZE;
+	st->f_blocks = fat_cluster_limit () - 1;
+	st->f_bfree = fat_fs->bs.free_clusters;
+	st->f_inodes = fat_fs->bs.used_inodes;
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Writes every dirty cached FAT sector to disk.  write_lock is
+ * dropped between sectors so allocation is not held up for the whole
+ * flush; each write happens under it, so a block cannot change or be
+ * evicted while it is on its way to disk. */
+void
+fat_flush (void) {
+	lock_acquire (&fat_fs->write_lock);
+	if (fat_fs->boot_dirty)
+		write_boot (false);
+	lock_release (&fat_fs->write_lock);
+
+	for (size_t i = 0; i < FAT_CACHE_SIZE; i++) {
+		struct fat_block *b = &fat_fs->cache[i];
+
+		lock_acquire (&fat_fs->write_lock);
+		if (b->in_use && b->dirty) {
+			journal_write (fat_fs->bs.fat_start + b->idx, b->entries);
+			b->dirty = false;
 		}
+		lock_release (&fat_fs->write_lock);
+	}
+}
+
+/* Writes FAT sector IDX to disk if it is cached and dirty. */
+void
+fat_flush_sector (unsigned idx) {
+	struct fat_block key;
+	struct hash_elem *e;
+
+	key.idx = idx;
+	lock_acquire (&fat_fs->write_lock);
+	e = hash_find (&fat_fs->blocks, &key.elem);
+	if (e != NULL) {
+		struct fat_block *b = hash_entry (e, struct fat_block, elem);
+		if (b->dirty) {
+			journal_write (fat_fs->bs.fat_start + idx, b->entries);
+			b->dirty = false;
+		}
+	}
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Returns the index of the FAT sector holding CLST's entry. */
+unsigned
+fat_sector_of (cluster_t clst) {
+	return clst / FAT_ENTRIES_PER_SECTOR;
+}
+
+/* Returns the journal region of the disk in *START and *CNT, or
+ * false if it was formatted without one. */
+bool
+fat_journal_region (disk_sector_t *start, size_t *cnt) {
+	if (fat_fs->bs.journal_sectors == 0)
+		return false;
+	*start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+	*cnt = fat_fs->bs.journal_sectors;
+	return true;
+}
+
+/* Background thread that keeps the on-disk FAT close behind the
+ * in-memory one.  With a journal, each pass commits the metadata
+ * gathered since the last, FAT included. */
+static void
+fat_flushd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (FAT_FLUSH_INTERVAL);
+		if (journal_enabled ())
+			journal_commit ();
+		else
+			fat_flush ();
 	}
 }
 
@@ -122,35 +300,51 @@ fat_create (void) {
 	fat_boot_create ();
 	fat_fs_init ();
 
-	// Create FAT table
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT creation failed");
-	
+	// Create an empty FAT table on disk, a page of sectors per command
+	uint8_t *buf = palloc_get_page (PAL_ZERO);
+	if (buf == NULL)
+		PANIC ("FAT create failed due to OOM");
+	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i += FAT_ZERO_CNT) {
+		unsigned cnt = fat_fs->bs.fat_sectors - i;
+		if (cnt > FAT_ZERO_CNT)
+			cnt = FAT_ZERO_CNT;
+		disk_write_multi (filesys_disk, fat_fs->bs.fat_start + i, cnt, buf);
+	}
+
+	// Every cluster starts out free, then the root directory takes one
+	fat_fs->bs.free_clusters = fat_cluster_limit () - 1;
+	fat_fs->bs.used_inodes = 0;
+	fat_fs->bs.counts_magic = FAT_COUNTS_MAGIC;
+
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
 	
-	// Fill up ROOT_DIR_CLUSTER region with 0
-	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
-	if (buf == NULL)
-		PANIC ("FAT create failed due to OOM");
+	// Fill up the root directory's inode sector with 0
 	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
-	free (buf);
+	palloc_free_page (buf);
 }
 
 /* fat_boot bs 구조체 초기화*/
+/* Each FAT sector describes DISK_SECTOR_SIZE / sizeof (cluster_t)
+ * clusters, so larger clusters shrink the FAT proportionally.  Disks
+ * big enough to spare it get a journal region between the FAT and
+ * the data clusters. */
 void
 fat_boot_create (void) {
+	unsigned int spc = fat_format_cluster_size;
+	unsigned int journal_sectors =
+	    disk_size (filesys_disk) >= JOURNAL_SECTORS * 16 ? JOURNAL_SECTORS : 0;
 	unsigned int fat_sectors =
-	    (disk_size (filesys_disk) - 1)
-	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
+	    (disk_size (filesys_disk) - 1 - journal_sectors)
+	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * spc + 1) + 1;
 	fat_fs->bs = (struct fat_boot){
 	    .magic = FAT_MAGIC,
-	    .sectors_per_cluster = SECTORS_PER_CLUSTER,
+	    .sectors_per_cluster = spc,
 	    .total_sectors = disk_size (filesys_disk),//20160 (9.84375MB)
 	    .fat_start = 1,
 	    .fat_sectors = fat_sectors,
 	    .root_dir_cluster = ROOT_DIR_CLUSTER,
+	    .journal_sectors = journal_sectors,
 	};
 }
 
@@ -160,17 +354,176 @@ fat_fs_init (void) {
 	/*fat_length: 파일 시스템에 얼마나 클러스터가 많은 지를 저장*/
 	/*20003 (20160, 20096)*/
 
+	/* Boot sectors written before the cluster size was configurable
+	 * may leave the field unset. */
+	if (fat_fs->bs.sectors_per_cluster == 0)
+		fat_fs->bs.sectors_per_cluster = SECTORS_PER_CLUSTER;
+
 	fat_fs->fat_length = fat_fs->bs.fat_sectors * DISK_SECTOR_SIZE / sizeof(cluster_t);
 
-	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors
+		+ fat_fs->bs.journal_sectors;
 
 	lock_init(&fat_fs->write_lock);
+
+	/* Called again when formatting; whatever was cached belonged to
+	 * the old file system. */
+	if (fat_fs->cache == NULL) {
+		fat_fs->cache = malloc (FAT_CACHE_SIZE * sizeof *fat_fs->cache);
+		if (fat_fs->cache == NULL)
+			PANIC ("FAT cache creation failed");
+	}
+	hash_init (&fat_fs->blocks, block_hash, block_less, NULL);
+	for (size_t i = 0; i < FAT_CACHE_SIZE; i++)
+		fat_fs->cache[i].in_use = false;
+	fat_fs->clock_hand = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* FAT cache                                                                  */
+/*----------------------------------------------------------------------------*/
+
+static uint64_t
+block_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct fat_block, elem)->idx);
+}
+
+static bool
+block_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct fat_block, elem)->idx
+		< hash_entry (b, struct fat_block, elem)->idx;
+}
+
+/* Picks a block to reuse, second-chance (clock) order, writing it
+ * back first if it is dirty.  With a journal, a dirty block is passed
+ * over for two turns of the clock: written back, it would take room
+ * in the running transaction that the journal keeps for operations,
+ * while the dirty blocks still cached are already counted for. */
+static struct fat_block *
+evict_block (void) {
+	size_t skip = journal_enabled () ? 2 * FAT_CACHE_SIZE : 0;
+
+	for (;;) {
+		struct fat_block *b = &fat_fs->cache[fat_fs->clock_hand];
+		fat_fs->clock_hand = (fat_fs->clock_hand + 1) % FAT_CACHE_SIZE;
+
+		if (!b->in_use)
+			return b;
+		if (b->accessed) {
+			b->accessed = false;
+			continue;
+		}
+		if (b->dirty && skip > 0) {
+			skip--;
+			continue;
+		}
+		if (b->dirty)
+			journal_write (fat_fs->bs.fat_start + b->idx, b->entries);
+		hash_delete (&fat_fs->blocks, &b->elem);
+		b->in_use = false;
+		return b;
+	}
+}
+
+/* Returns the cached block holding CLST's entry, reading it in if
+ * needed.  Must be called with write_lock held. */
+static struct fat_block *
+get_block (cluster_t clst) {
+	struct fat_block key, *b;
+	struct hash_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&fat_fs->write_lock));
+	ASSERT (clst < fat_fs->fat_length);
+
+	key.idx = clst / FAT_ENTRIES_PER_SECTOR;
+	e = hash_find (&fat_fs->blocks, &key.elem);
+	if (e != NULL)
+		b = hash_entry (e, struct fat_block, elem);
+	else {
+		b = evict_block ();
+		b->idx = key.idx;
+		journal_read (fat_fs->bs.fat_start + b->idx, b->entries);
+		b->in_use = true;
+		b->dirty = false;
+		hash_insert (&fat_fs->blocks, &b->elem);
+	}
+	b->accessed = true;
+	return b;
+}
+
+/* Returns CLST's raw entry, flags included.
+ * Must be called with write_lock held. */
+static cluster_t
+entry_get (cluster_t clst) {
+	return get_block (clst)->entries[clst % FAT_ENTRIES_PER_SECTOR];
+}
+
+/* Sets CLST's raw entry to VAL.
+ * Must be called with write_lock held. */
+static void
+entry_set (cluster_t clst, cluster_t val) {
+	struct fat_block *b = get_block (clst);
+	cluster_t *e = &b->entries[clst % FAT_ENTRIES_PER_SECTOR];
+
+	/* Keep the free cluster count in step with the FAT. */
+	if ((*e == 0) != (val == 0)) {
+		if (val == 0)
+			fat_fs->bs.free_clusters++;
+		else
+			fat_fs->bs.free_clusters--;
+		fat_fs->boot_dirty = true;
+	}
+	*e = val;
+	b->dirty = true;
+}
+
+/* Links CLST to VAL, keeping CLST's flags; VAL 0 frees CLST and
+ * clears them.  Must be called with write_lock held. */
+static void
+entry_link (cluster_t clst, cluster_t val) {
+	if (val == 0)
+		entry_set (clst, 0);
+	else
+		entry_set (clst, (entry_get (clst) & FAT_FLAGS) | val);
 }
 
 /*----------------------------------------------------------------------------*/
 /* FAT handling                                                               */
 /*----------------------------------------------------------------------------*/
 
+/* Returns one past the highest cluster number that maps onto the
+ * disk.  The FAT's last sector may describe clusters beyond it. */
+static cluster_t
+fat_cluster_limit (void) {
+	cluster_t limit = (fat_fs->bs.total_sectors - fat_fs->data_start)
+		/ fat_fs->bs.sectors_per_cluster + 1;
+	return limit < fat_fs->fat_length ? limit : fat_fs->fat_length;
+}
+
+/* Finds a free cluster, preferring the one right after CLST so that
+ * a growing chain stays contiguous on disk, and otherwise searching
+ * onward from the last allocation (next fit).  Returns 0 if the disk
+ * is full.  Must be called with write_lock held. */
+static cluster_t
+find_free_cluster (cluster_t clst) {
+	const cluster_t first = fat_fs->bs.fat_start + 1;
+	const cluster_t limit = fat_cluster_limit ();
+	cluster_t i;
+
+	if (clst != 0 && clst + 1 < limit && entry_get (clst + 1) == 0)
+		return clst + 1;
+
+	i = fat_fs->last_clst;
+	for (cluster_t n = first; n < limit; n++) {
+		if (++i < first || i >= limit)
+			i = first;
+		if (entry_get (i) == 0)
+			return i;
+	}
+	return 0;
+}
+
 /* Add a cluster to the chain.
  * If CLST is 0, start a new chain.
  * Returns 0 if fails to allocate a new cluster. */
@@ -178,89 +531,202 @@ cluster_t
 fat_create_chain (cluster_t clst) {
 	/* TODO: Your code goes here. */
 	cluster_t i;
-	for(i = fat_fs->bs.fat_start + 1; i < fat_fs->fat_length; i++) {
-		if (fat_get(i) == 0) {
-			if(clst == 0) {
-				fat_put(i, EOChain);
-			}
-			else {
-				fat_put(i, EOChain);
-				fat_put(clst, i);
-			}
-			return i;
-		}
+	lock_acquire(&fat_fs->write_lock);
+	/* A full disk fails at once instead of after scanning the FAT. */
+	if (fat_fs->bs.free_clusters == 0) {
+		lock_release(&fat_fs->write_lock);
+		return 0;
+	}
+	i = find_free_cluster(clst);
+	if (i == 0) {
+		lock_release(&fat_fs->write_lock);
+		return 0;
+	}
+	entry_link(i, EOChain);
+	if(clst != 0) {
+		entry_link(clst, i);
+	}
+	fat_fs->last_clst = i;
+	lock_release(&fat_fs->write_lock);
+	if (fat_ordered_writes)
+		fat_flush ();
+	return i;
+}
+
+/* Returns the first cluster of a run of CNT free clusters in
+ * [FROM, LIMIT), or 0 if there is none.
+ * Must be called with write_lock held. */
+static cluster_t
+find_free_run (cluster_t from, cluster_t limit, size_t cnt) {
+	size_t run = 0;
+
+	for (cluster_t i = from; i < limit; i++) {
+		if (entry_get (i) != 0)
+			run = 0;
+		else if (++run == cnt)
+			return i + 1 - cnt;
 	}
 	return 0;
 }
 
+/* Allocates CNT physically contiguous clusters at once, links them
+ * after CLST (or as a new chain if CLST is 0), and marks them all
+ * unwritten.  The run goes right after CLST if there is room there,
+ * otherwise at the next free run from the last allocation.  Returns
+ * the run's first cluster, or 0 if no free run is long enough. */
+cluster_t
+fat_create_run (cluster_t clst, size_t cnt) {
+	const cluster_t first = fat_fs->bs.fat_start + 1;
+	const cluster_t limit = fat_cluster_limit ();
+	cluster_t start = 0;
+
+	ASSERT (cnt > 0);
+
+	lock_acquire (&fat_fs->write_lock);
+	if (fat_fs->bs.free_clusters < cnt) {
+		lock_release (&fat_fs->write_lock);
+		return 0;
+	}
+	if (clst != 0 && clst + 1 + cnt <= limit)
+		start = find_free_run (clst + 1, clst + 1 + cnt, cnt);
+	if (start == 0 && fat_fs->last_clst + 1 < limit)
+		start = find_free_run (fat_fs->last_clst + 1, limit, cnt);
+	if (start == 0)
+		start = find_free_run (first, limit, cnt);
+	if (start == 0) {
+		lock_release (&fat_fs->write_lock);
+		return 0;
+	}
+
+	for (cluster_t c = start; c < start + cnt; c++)
+		entry_set (c, (c + 1 < start + cnt ? c + 1 : EOChain) | FAT_UNWRITTEN);
+	if (clst != 0)
+		entry_link (clst, start);
+	fat_fs->last_clst = start + cnt - 1;
+	lock_release (&fat_fs->write_lock);
+	if (fat_ordered_writes)
+		fat_flush ();
+	return start;
+}
+
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
 	/* TODO: Your code goes here. */
-	if(clst > fat_fs->fat_length) {
+	if(clst == 0 || clst >= fat_fs->fat_length) {
 		return;
 	}
 
 	cluster_t i = clst;
 	cluster_t val;
-	while(i != EOChain) {
-		val = fat_get(i);
-		fat_put(i, 0);
+	lock_acquire(&fat_fs->write_lock);
+	while(i != EOChain && i != 0) {
+		val = entry_get(i) & ~FAT_FLAGS;
+		/* The cluster may have held metadata; keep the journal from
+		 * writing it after the cluster is reused. */
+		for (unsigned s = 0; s < fat_fs->bs.sectors_per_cluster; s++)
+			journal_forget (cluster_to_sector (i) + s);
+		entry_link(i, 0);
 		i = val;
 	}
 	if(pclst != 0) {
-		fat_put(pclst, EOChain);
+		entry_link(pclst, EOChain);
 	}
+	lock_release(&fat_fs->write_lock);
+	if (fat_ordered_writes)
+		fat_flush ();
 }
 
-/* Update a value in the FAT table. */
+/* Update a value in the FAT table.
+ * Flags on CLST survive relinking; freeing it (VAL 0) clears them. */
 void
 fat_put (cluster_t clst, cluster_t val) {
 	/* TODO: Your code goes here. */
-	fat_fs->fat[clst] = val;
-
+	lock_acquire (&fat_fs->write_lock);
+	entry_link (clst, val);
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Fetch a value in the FAT table. */
 cluster_t
 fat_get (cluster_t clst) {
 	/* TODO: Your code goes here. */
-	return fat_fs->fat[clst];
+	cluster_t val;
+
+	lock_acquire (&fat_fs->write_lock);
+	val = entry_get (clst) & ~FAT_FLAGS;
+	lock_release (&fat_fs->write_lock);
+	return val;
 }
 
-/* Covert a cluster # to a sector number. */
+/* Returns true if CLST is allocated but has never been written. */
+bool
+fat_is_unwritten (cluster_t clst) {
+	cluster_t val;
+
+	lock_acquire (&fat_fs->write_lock);
+	val = entry_get (clst);
+	lock_release (&fat_fs->write_lock);
+	return (val & FAT_UNWRITTEN) != 0;
+}
+
+/* Marks CLST as unwritten or written. */
+void
+fat_set_unwritten (cluster_t clst, bool unwritten) {
+	lock_acquire (&fat_fs->write_lock);
+	if (unwritten)
+		entry_set (clst, entry_get (clst) | FAT_UNWRITTEN);
+	else
+		entry_set (clst, entry_get (clst) & ~FAT_UNWRITTEN);
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Covert a cluster # to a sector number.
+ * Cluster 1 (the root directory) is the first data cluster. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
 	/* TODO: Your code goes here. */
-	return clst + fat_fs->bs.fat_sectors;
+	return fat_fs->data_start + (clst - 1) * fat_fs->bs.sectors_per_cluster;
 }
+
+/* Returns the cluster that SECT lies in. */
 cluster_t
 sector_to_cluster (disk_sector_t sect) {
 	/* TODO: Your code goes here. */
-	return sect - fat_fs->bs.fat_sectors;
+	return (sect - fat_fs->data_start) / fat_fs->bs.sectors_per_cluster + 1;
+}
+
+/* Returns the number of sectors in each cluster. */
+unsigned int
+fat_sectors_per_cluster (void) {
+	return fat_fs->bs.sectors_per_cluster;
 }
 
+/* Returns the sector holding byte POS of the chain whose first
+ * cluster starts at sector START, or -1 if the chain ends first. */
 disk_sector_t
 get_sector(disk_sector_t start, off_t pos){
+	const unsigned spc = fat_fs->bs.sectors_per_cluster;
+	const off_t sector_idx = pos / DISK_SECTOR_SIZE;
 	cluster_t start_clst = sector_to_cluster(start);
 	// printf("get_sector========disk_sector_t : %d\n",start);
 	// cluster_t start_clst = start;
 	
-	for (unsigned i = 0; i < pos / DISK_SECTOR_SIZE; i++){
+	for (unsigned i = 0; i < sector_idx / spc; i++){
 		start_clst = fat_get(start_clst);
 		if (start_clst == EOChain || start_clst == 0) {
 			return -1;
 		}
 	}
-	return cluster_to_sector(start_clst);
+	return cluster_to_sector(start_clst) + sector_idx % spc;
 }
 
 
 void print_fat(){
 	printf("\n===================print FAT====================================================================================\n");
 	for(int i = 0; i < 200; i++){
-		printf(" [%4d|%10d] ", i, fat_fs->fat[i]);
+		printf(" [%4d|%10d] ", i, fat_get(i));
 		if(i%5 == 4) printf("\n");
 	}
 	printf("\n================================================================================================================\n");
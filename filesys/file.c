@@ -1,7 +1,11 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "filesys/readahead.h"
+#include <uio.h>
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 #include "userprog/syscall.h"
 #include "threads/thread.h"
 
@@ -20,6 +24,8 @@ file_open (struct inode *inode) {
 		file->pos = 0;
 		file->deny_write = false;
 		file->dup_count = 0;
+		file->ra = NULL;
+		file->ra_next = 0;
 		return file;
 	} else {
 		inode_close (inode);
@@ -55,6 +61,7 @@ void
 file_close (struct file *file) {
 	if (file != NULL) {
 		file_allow_write (file);
+		readahead_release (file);
 		inode_close (file->inode);
 		free (file);
 	}
@@ -77,7 +84,11 @@ file_get_inode (struct file *file) {
  * FILE의 위치를 읽어들인 바이트 수 만큼 옮김니다. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
-	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	off_t bytes_read = readahead_read (file, buffer, size, file->pos);
+	if (bytes_read < size)
+		bytes_read += inode_read_at (file->inode, (uint8_t *) buffer + bytes_read,
+				size - bytes_read, file->pos + bytes_read);
+	readahead_update (file, file->pos, bytes_read);
 	file->pos += bytes_read;
 	return bytes_read;
 }
@@ -130,6 +141,99 @@ file_write_at (struct file *file, const void *buffer, off_t size,
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads from FILE into the CNT buffers of IOV in turn, starting at
+ * the file's current position, and advances the position by the
+ * number of bytes read, which is returned. */
+off_t
+file_readv (struct file *file, const struct iovec *iov, int cnt) {
+	off_t bytes_read = inode_read_iov (file->inode, iov, cnt, file->pos);
+	file->pos += bytes_read;
+	return bytes_read;
+}
+
+/* Writes the CNT buffers of IOV in turn into FILE, starting at the
+ * file's current position, and advances the position by the number
+ * of bytes written, which is returned.  Directories cannot be
+ * written. */
+off_t
+file_writev (struct file *file, const struct iovec *iov, int cnt) {
+	if (inode_is_dir (file->inode))
+		return -1;
+	off_t bytes_written = inode_write_iov (file->inode, iov, cnt, file->pos);
+	file->pos += bytes_written;
+	return bytes_written;
+}
+
+/* Copies up to SIZE bytes from IN, starting at its current position,
+ * to OUT at its current position, advancing both.  The data passes
+ * through a kernel page, a whole number of sectors at a time, so
+ * aligned copies move straight between the disk and that page.
+ * Returns the number of bytes copied, which is less than SIZE if IN
+ * ends first or OUT cannot grow, or -1 if OUT is a directory, IN and
+ * OUT are the same file and the two ranges overlap, or no memory is
+ * available. */
+off_t
+file_copy_range (struct file *in, struct file *out, off_t size) {
+	off_t bytes_copied = 0;
+	off_t left = inode_length (in->inode) - in->pos;
+	void *buffer;
+
+	if (inode_is_dir (out->inode))
+		return -1;
+	if (size > left)
+		size = left;
+	if (size <= 0)
+		return 0;
+	if (in->inode == out->inode
+			&& in->pos < out->pos + size && out->pos < in->pos + size)
+		return -1;
+
+	buffer = palloc_get_page (0);
+	if (buffer == NULL)
+		return -1;
+	while (size > 0) {
+		off_t chunk = size < PGSIZE ? size : PGSIZE;
+		off_t n = inode_read_at (in->inode, buffer, chunk, in->pos);
+		if (n <= 0)
+			break;
+		n = inode_write_at (out->inode, buffer, n, out->pos);
+		if (n <= 0)
+			break;
+		in->pos += n;
+		out->pos += n;
+		bytes_copied += n;
+		size -= n;
+	}
+	palloc_free_page (buffer);
+	return bytes_copied;
+}
+
+/* Writes everything written to FILE so far through to disk. */
+void
+file_sync (struct file *file) {
+	ASSERT (file != NULL);
+	inode_sync (file->inode);
+}
+
+/* Reserves disk space for LEN bytes of FILE starting at OFFSET,
+ * growing FILE if the range reaches past its end.  The reserved
+ * space reads as zeros.  Directories cannot be grown this way. */
+bool
+file_allocate (struct file *file, off_t offset, off_t len) {
+	ASSERT (file != NULL);
+	if (inode_is_dir (file->inode))
+		return false;
+	return inode_allocate (file->inode, offset, len);
+}
+
+/* Moves FILE's data into contiguous clusters.  Stores the number of
+ * fragments it had before and has after in *BEFORE and *AFTER. */
+bool
+file_defrag (struct file *file, size_t *before, size_t *after) {
+	ASSERT (file != NULL);
+	return inode_defrag (file->inode, before, after);
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 void
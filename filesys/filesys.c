@@ -6,15 +6,23 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/dcache.h"
+#include "filesys/journal.h"
+#include "filesys/readahead.h"
 #include "devices/disk.h"
 #include "include/filesys/fat.h"
 #include "include/threads/thread.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
+
+/* Stripe the file system over hd0:1 and hd1:0 ("-stripe").  The
+ * members are on different channels, so their transfers overlap. */
+bool filesys_striped;
 #define PATH_MAX_LEN 256
 
 static void do_format (void);
+static unsigned count_inodes (struct dir *);
 
 /* Initializes the file system module.
  * If FORMAT is true, reformats the file system. */
@@ -23,16 +31,31 @@ filesys_init (bool format) {
 	filesys_disk = disk_get (0, 1);
 	if (filesys_disk == NULL)
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
+	if (filesys_striped) {
+		struct disk *members[2] = { filesys_disk, disk_get (1, 0) };
+
+		if (members[1] == NULL)
+			PANIC ("hd1:0 (hdc) not present, cannot stripe file system");
+		filesys_disk = disk_stripe (members, 2);
+		if (filesys_disk == NULL)
+			PANIC ("striped volume creation failed");
+	}
 
 	inode_init ();
+	dcache_init ();
+	readahead_init ();
 
 #ifdef EFILESYS
+	journal_init ();
 	fat_init ();
+	journal_open ();
 
 	if (format)
 		do_format ();
 
 	fat_open ();
+	if (fat_inodes_unknown ())
+		fat_count_inode (count_inodes (dir_open_root ()));
 	thread_current()->cur_dir = dir_open_root();
 #else
 	/* Original FS */
@@ -50,6 +73,7 @@ filesys_init (bool format) {
 void
 filesys_done (void) {
 	/* Original FS */
+	inode_flush_all ();
 #ifdef EFILESYS
 	fat_close ();
 #else
@@ -57,6 +81,22 @@ filesys_done (void) {
 #endif
 }
 
+/* Writes all pending file system metadata to disk: the FAT first,
+ * then the inodes that refer to it.  With a journal, both go into
+ * one commit instead. */
+void
+filesys_sync (void) {
+#ifdef EFILESYS
+	if (journal_enabled ()) {
+		inode_flush_all ();
+		journal_sync ();
+		return;
+	}
+	fat_flush ();
+#endif
+	inode_flush_all ();
+}
+
 /* Creates a file named NAME with the given INITIAL_SIZE.
  * Returns true if successful, false otherwise.
  * Fails if a file named NAME already exists,
@@ -76,19 +116,23 @@ filesys_create (const char *name, off_t initial_size) {
 
 	// struct dir *dir = dir_open_root ();
 	/* 추후 삭제 예정 */
+	journal_begin ();
 	cluster_t clst = fat_create_chain(0);
 	inode_sector = cluster_to_sector(clst);
 
 	bool success = (dir != NULL
-            // && inode_sector
+            && clst != 0
 			&& inode_create (inode_sector, initial_size, 0)
 			&& dir_add (dir, file_name, inode_sector)
             );
 
-	if (!success && inode_sector != 0)
+	if (!success && clst != 0)
 		// free_map_release (inode_sector, 1);
-		fat_remove_chain(sector_to_cluster(inode_sector), 0);
+		fat_remove_chain(clst, 0);
+	if (success)
+		fat_count_inode (1);
 	dir_close (dir);
+	journal_end ();
     free(cp_name);
     free(file_name);
 
@@ -161,6 +205,7 @@ filesys_remove (const char *name) {
         struct inode *inode = NULL;
         bool success = false;
 
+        journal_begin ();
         if(dir != NULL) {
             dir_lookup(dir, file_name, &inode);
         }
@@ -179,6 +224,7 @@ filesys_remove (const char *name) {
             success = dir != NULL && dir_remove(dir, file_name);
         }
         dir_close(dir);
+        journal_end ();
         free(cp_name);
         free(file_name);
         return success;
@@ -199,15 +245,17 @@ do_format (void) {
 #ifdef EFILESYS
 	/* Create FAT and save it to the disk. */
 	fat_create();
+	journal_format ();
 
 	/* Root Directory 생성 */
 	disk_sector_t root = cluster_to_sector(ROOT_DIR_CLUSTER);
 	if (!dir_create(root, 16))
 		PANIC("root directory creation failed");
+	fat_count_inode (1);
 
     struct dir *root_dir = dir_open_root();
-    dir_add(root_dir, ".", ROOT_DIR_SECTOR);
-    dir_add(root_dir, "..", ROOT_DIR_SECTOR);
+    dir_add(root_dir, ".", root);
+    dir_add(root_dir, "..", root);
     dir_close(root_dir);
 	fat_close();
 #else
@@ -220,28 +268,49 @@ do_format (void) {
 	printf ("done.\n");
 }
 
+/* Returns the number of inodes in the tree under DIR, DIR's own
+ * included, and closes DIR.  Used only to rebuild the count kept in
+ * the boot sector after it was lost. */
+static unsigned
+count_inodes (struct dir *dir) {
+	char name[NAME_MAX + 1];
+	unsigned cnt = 1;
+
+	if (dir == NULL)
+		return 0;
+	while (dir_readdir (dir, name)) {
+		struct inode *inode;
+
+		if (!strcmp (name, ".") || !strcmp (name, "..")
+				|| !dir_lookup (dir, name, &inode))
+			continue;
+		if (inode_is_dir (inode))
+			cnt += count_inodes (dir_open (inode));
+		else {
+			cnt++;
+			inode_close (inode);
+		}
+	}
+	dir_close (dir);
+	return cnt;
+}
+
 struct dir *parse_path(char *path_name, char *file_name)
 {
-	struct dir *dir;
-	struct inode *inode = NULL;
+	struct dir *cur_dir = thread_current()->cur_dir;
+	disk_sector_t sector;
+	bool is_dir;
 
 	if (path_name == NULL || file_name == NULL)
 		goto fail;
 	if (strlen(path_name) == 0)
 		goto fail;
 
-	// printf("parse_path : %s\n", path_name);
-
-	/* path_name의 절대/상대경로에 따른 디렉터리 정보 저장*/
-	if (path_name[0] == '/')
-	{
-		dir = dir_open_root();
-	}
+	/* path_name의 절대/상대경로에 따른 시작 디렉터리의 inode 섹터 */
+	if (path_name[0] == '/' || cur_dir == NULL)
+		sector = cluster_to_sector(ROOT_DIR_CLUSTER);
 	else
-	{
-		dir = dir_reopen(thread_current()->cur_dir);
-	}
-
+		sector = inode_get_inumber(dir_get_inode(cur_dir));
 
 	char *token, *nextToken, *savePtr;
 	token = strtok_r(path_name, "/", &savePtr);
@@ -249,37 +318,23 @@ struct dir *parse_path(char *path_name, char *file_name)
 
 	/* "/"를 오픈하는 경우 */
 	if (token == NULL)
-	{
-		token = (char *)malloc(2);
-		strlcpy(token, ".", 2);
-	}
+		token = ".";
 
+	/* Walk intermediate components by inode sector only.  Each step
+	 * is answered by the dcache when the path was resolved before,
+	 * so only the final parent directory is actually opened. */
 	while (token != NULL && nextToken != NULL)
 	{
-		/* dir에서 token이름의 파일을 검색하여 inode의 정보를 저장*/
-		if (!dir_lookup(dir, token, &inode))
-		{
-			dir_close(dir);
+		/* token이 없거나 파일일 경우 NULL 반환 */
+		if (!dir_lookup_sector(sector, token, &sector, &is_dir) || !is_dir)
 			goto fail;
-		}
-
-		/* inode가 파일일 경우 NULL 반환 */
-		if (!inode_is_dir(inode))
-		{
-			dir_close(dir);
-			inode_close(inode);
-			goto fail;
-		}
-
-		dir_close(dir);		   // dir의 디렉터리 정보를 메모리에서 해지
-		dir = dir_open(inode); // inode에 해당하는 디렉터리 정보를 dir에 저장
 
 		token = nextToken; // token에 검색할 다음 경로이름 저장
 		nextToken = strtok_r(NULL, "/", &savePtr);
 	}
 	strlcpy(file_name, token, strlen(token) + 1); // token의 파일 이름을 file_name에 저장 */
 
-	return dir; // dir 정보 반환
+	return dir_open(inode_open(sector)); // dir 정보 반환
 
 fail:
 	return NULL;
@@ -292,25 +347,31 @@ bool filesys_create_dir(const char *name) {
     char *file_name = (char *)malloc(PATH_MAX_LEN + 1);
 
     struct dir *dir = parse_path(cp_name, file_name);
+    journal_begin ();
     cluster_t clst = fat_create_chain(0);
+    disk_sector_t inode_sector = cluster_to_sector(clst);
 
     struct inode *inode;
     struct dir *sub_dir = NULL;
 
     success = (
         dir != NULL
-        && dir_create(clst, 16)
-        && dir_add(dir, file_name, clst)
+        && clst != 0
+        && dir_create(inode_sector, 16)
+        && dir_add(dir, file_name, inode_sector)
         && dir_lookup(dir, file_name, &inode)
-        && dir_add(sub_dir = dir_open(inode), ".", clst)
+        && dir_add(sub_dir = dir_open(inode), ".", inode_sector)
         && dir_add(sub_dir, "..", inode_get_inumber(dir_get_inode(dir)))
     );
 
     if(!success && clst != 0) {
         fat_remove_chain(clst, 0);
     }
+    if (success)
+        fat_count_inode (1);
     dir_close(sub_dir);
     dir_close(dir);
+    journal_end ();
     free(cp_name);
     free(file_name);
     return success;
@@ -342,98 +403,3 @@ bool filesys_change_dir(char *path)
     return true;
 
 }
-
-bool filesys_create_dir(char *name)
-{
-    disk_sector_t inode_sector = 0;
-    char *parse_name = (char *)malloc(sizeof(char) * (PATH_MAX_LEN + 1));
-    struct dir *dir = parse_path(name, parse_name);
-
-    bool success = (dir != NULL && dir_create(inode_sector, 16) && dir_add(dir, parse_name, inode_sector));
-
-    if (success)
-    {
-        add_dot(inode_sector, inode_get_inumber(dir_get_inode(dir)));
-        free(parse_name);
-        dir_close(dir);
-        return true;
-    }
-    else
-    {
-        if (inode_sector)
-        {
-            free_map_release(inode_sector, 1);
-        }
-        free(parse_name);
-        dir_close(dir);
-        return false;
-    }
-
-    return false;
-}
-
-
-struct dir *parse_path(char *name, char *file_name)
-{
-    struct dir *dir = NULL;
-    if (!name || !file_name || strlen(name) == 0)
-        return NULL;
-
-    char *path = (char *)malloc(sizeof(char) * (PATH_MAX_LEN + 1));
-    strlcpy(path, name, PATH_MAX_LEN);
-
-    if (path[0] == '/')
-    {
-        dir = dir_open_root();
-    }
-    else
-    {
-        dir = dir_reopen(thread_current()->cur_dir);
-    }
-
-    char *token, *next_token, *save_ptr;
-    token = strtok_r(path, "/", &save_ptr);
-    next_token = strtok_r(NULL, "/", &save_ptr);
-
-    if (dir == NULL)
-    {
-        return NULL;
-    }
-
-    if (!inode_is_dir(dir_get_inode(dir)))
-    {
-        return NULL;
-    }
-
-    for (; token != NULL && next_token != NULL; token = next_token, next_token = strtok_r(NULL, "/", &save_ptr))
-    {
-        struct inode *inode = NULL;
-        if (!dir_lookup(dir, token, &inode) || !inode_is_dir(inode))
-        {
-            dir_close(dir);
-            return NULL;
-        }
-        dir_close(dir);
-        dir = dir_open(inode);
-    }
-
-    if (token == NULL)
-    {
-        strlcpy(file_name, ".", PATH_MAX_LEN);
-    }
-    else
-    {
-        strlcpy(file_name, token, PATH_MAX_LEN);
-    }
-
-    free(path);
-    return dir;
-}
-
-static void add_dot(disk_sector_t cur, disk_sector_t parent)
-{
-    struct dir *dir = dir_open(inode_open(cur));
-    dir_add(dir, ".", cur);
-    dir_add(dir, "..", parent);
-    dir_close(dir);
-}
\ No newline at end of file
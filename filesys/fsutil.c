@@ -6,6 +6,7 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "devices/disk.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
@@ -65,6 +66,66 @@ fsutil_rm (char **argv) {
 		PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Totals gathered by fsutil_defrag(). */
+struct defrag_totals {
+	size_t files;               /* Files and directories examined. */
+	size_t failed;              /* Ones that could not be moved. */
+	size_t before;              /* Fragments before. */
+	size_t after;               /* Fragments after. */
+};
+
+/* Defragments INODE, then everything below it if it is a
+ * directory, adding the results to T. */
+static void
+defrag_tree (struct inode *inode, struct defrag_totals *t) {
+	size_t before, after;
+	char name[NAME_MAX + 1];
+	struct dir *dir;
+
+	t->files++;
+	if (!inode_defrag (inode, &before, &after))
+		t->failed++;
+	t->before += before;
+	t->after += after;
+	if (!inode_is_dir (inode))
+		return;
+
+	dir = dir_open (inode_reopen (inode));
+	if (dir == NULL)
+		return;
+	while (dir_readdir (dir, name)) {
+		struct inode *child;
+
+		if (!strcmp (name, ".") || !strcmp (name, ".."))
+			continue;
+		if (dir_lookup (dir, name, &child)) {
+			defrag_tree (child, t);
+			inode_close (child);
+		}
+	}
+	dir_close (dir);
+}
+
+/* Moves the data of every file in the file system into contiguous
+ * clusters and reports the fragmentation before and after. */
+void
+fsutil_defrag (char **argv UNUSED) {
+	struct defrag_totals t = { 0, 0, 0, 0 };
+	struct dir *root;
+
+	printf ("Defragmenting file system...\n");
+	root = dir_open_root ();
+	if (root == NULL)
+		PANIC ("root dir open failed");
+	defrag_tree (dir_get_inode (root), &t);
+	dir_close (root);
+	printf ("%zu files: %zu fragments before, %zu after", t.files,
+			t.before, t.after);
+	if (t.failed > 0)
+		printf (", %zu not moved for lack of contiguous space", t.failed);
+	printf ("\n");
+}
+
 /* Copies from the "scratch" disk, hdc or hd1:0 to file ARGV[1]
  * in the file system.
  *
@@ -107,6 +168,8 @@ fsutil_put (char **argv) {
 	src = disk_get (1, 0);
 	if (src == NULL)
 		PANIC ("couldn't open source disk (hdc or hd1:0)");
+	if (filesys_striped)
+		PANIC ("source disk (hdc or hd1:0) is striped into the file system");
 
 	/* Read file size. */
 	disk_read (src, sector++, buffer);
@@ -187,6 +250,8 @@ fsutil_get (char **argv) {
 	dst = disk_get (1, 0);
 	if (dst == NULL)
 		PANIC ("couldn't open target disk (hdc or hd1:0)");
+	if (filesys_striped)
+		PANIC ("target disk (hdc or hd1:0) is striped into the file system");
 
 	/* Write size to sector 0. */
 	memset (buffer, 0, DISK_SECTOR_SIZE);
@@ -1,4 +1,9 @@
 #include "filesys/inode.h"
+#include "filesys/dcache.h"
+#include "filesys/journal.h"
+#include <uio.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 // #include <list.h>
 // #include <debug.h>
 // #include <round.h>
@@ -24,18 +29,54 @@ bytes_to_sectors (off_t size) {
 
 
 
+#ifdef EFILESYS
+/* Returns INODE's I'th extent, direct or indirect. */
+static struct inode_extent *
+extent_at (struct inode *inode, size_t i) {
+	if (i < INODE_DIRECT_EXTENTS)
+		return &inode->data.extents[i];
+	return &inode->ind_extents[i - INODE_DIRECT_EXTENTS];
+}
+
+/* Returns the size of a cluster in bytes. */
+static inline off_t
+cluster_bytes (void) {
+	return (off_t) fat_sectors_per_cluster () * DISK_SECTOR_SIZE;
+}
+
+/* Returns the sector holding byte offset POS according to INODE's
+ * extents, or -1 if the extents end before POS. */
+static disk_sector_t
+extent_to_sector (struct inode *inode, off_t pos) {
+	cluster_t idx = pos / cluster_bytes ();
+	unsigned sector_in_clst = pos / DISK_SECTOR_SIZE % fat_sectors_per_cluster ();
+
+	for (size_t i = 0; i < inode->data.extent_cnt; i++) {
+		struct inode_extent *e = extent_at (inode, i);
+		if (idx < e->count)
+			return cluster_to_sector (e->start + idx) + sector_in_clst;
+		idx -= e->count;
+	}
+	return -1;
+}
+#endif
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
  * POS. */
 /* offset이 존재하는 disk_sector 번호를 반환*/
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) {
+byte_to_sector (struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
 
 	// printf("==========byte_to_sector 진입 inode->data.length : %d \n",inode->data.length);
 	if (pos < inode->data.length){
 		#ifdef EFILESYS
+			if (inode->data.start == 0)
+				return -1;
+			if (inode->data.extent_cnt > 0)
+				return extent_to_sector (inode, pos);
 			return get_sector(inode->data.start, pos);
 		#else
 			// printf("==========byte_to_sector 진입 #else\n");
@@ -47,14 +88,280 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 		return -1;
 }
 
+/* Reads CNT sectors of INODE's data, starting at SECTOR, into
+ * BUFFER.  A directory's contents are metadata, so they go through
+ * the journal like its inode does. */
+static void
+data_read (struct inode *inode, disk_sector_t sector, size_t cnt,
+		void *buffer) {
+	if (inode->data.is_dir)
+		for (size_t i = 0; i < cnt; i++)
+			journal_read (sector + i, (uint8_t *) buffer + i * DISK_SECTOR_SIZE);
+	else
+		disk_read_multi (filesys_disk, sector, cnt, buffer);
+}
+
+/* Writes CNT sectors of INODE's data, starting at SECTOR, from
+ * BUFFER, through the journal if INODE is a directory. */
+static void
+data_write (struct inode *inode, disk_sector_t sector, size_t cnt,
+		const void *buffer) {
+	if (inode->data.is_dir)
+		for (size_t i = 0; i < cnt; i++)
+			journal_write (sector + i,
+					(const uint8_t *) buffer + i * DISK_SECTOR_SIZE);
+	else
+		disk_write_multi (filesys_disk, sector, cnt, buffer);
+}
+
+/* Returns true if SECTOR, as returned by byte_to_sector(), holds no
+ * data yet: either it lies past the end of the cluster chain, or its
+ * cluster is allocated but still unwritten.  Such ranges read as
+ * zeros without any disk I/O. */
+static bool
+sector_is_hole (disk_sector_t sector) {
+#ifdef EFILESYS
+	return sector == (disk_sector_t) -1
+		|| fat_is_unwritten (sector_to_cluster (sector));
+#else
+	return false;
+#endif
+}
+
+#ifdef EFILESYS
+/* Remembers that the FAT entry of CLST changed on INODE's behalf, so
+ * that inode_sync() can write just the FAT sectors this file needs. */
+static void
+note_fat_change (struct inode *inode, cluster_t clst) {
+	unsigned idx = fat_sector_of (clst);
+
+	if (inode->fat_dirty_cnt < 0)
+		return;
+	for (int i = 0; i < inode->fat_dirty_cnt; i++)
+		if (inode->fat_dirty[i] == idx)
+			return;
+	if (inode->fat_dirty_cnt == INODE_FAT_TRACK)
+		inode->fat_dirty_cnt = -1;
+	else
+		inode->fat_dirty[inode->fat_dirty_cnt++] = idx;
+}
+
+/* Stops describing INODE by extents, falling back to its FAT chain.
+ * Used when the file is too fragmented for INODE_MAX_EXTENTS. */
+static void
+extents_drop (struct inode *inode) {
+	if (inode->data.indirect != 0) {
+		fat_remove_chain (sector_to_cluster (inode->data.indirect), 0);
+		inode->data.indirect = 0;
+	}
+	free (inode->ind_extents);
+	inode->ind_extents = NULL;
+	inode->ind_dirty = false;
+	inode->data.extent_cnt = 0;
+	inode->dirty = true;
+}
+
+/* Records CLST as the cluster following INODE's current last one.
+ * Grows the last extent when CLST is adjacent to it, which is the
+ * common case since allocation prefers the next cluster.  Returns
+ * false if every extent slot is in use. */
+static bool
+extent_append (struct inode *inode, cluster_t clst) {
+	size_t n = inode->data.extent_cnt;
+	struct inode_extent *e;
+
+	if (n > 0) {
+		e = extent_at (inode, n - 1);
+		if (e->start + e->count == clst) {
+			e->count++;
+			goto done;
+		}
+	}
+	if (n >= INODE_MAX_EXTENTS)
+		return false;
+	if (n == INODE_DIRECT_EXTENTS) {
+		cluster_t ind = fat_create_chain (0);
+		if (ind == 0)
+			return false;
+		inode->ind_extents = calloc (1, DISK_SECTOR_SIZE);
+		if (inode->ind_extents == NULL) {
+			fat_remove_chain (ind, 0);
+			return false;
+		}
+		inode->data.indirect = cluster_to_sector (ind);
+		note_fat_change (inode, ind);
+	}
+	e = extent_at (inode, n);
+	e->start = clst;
+	e->count = 1;
+	inode->data.extent_cnt++;
+
+done:
+	if (n > INODE_DIRECT_EXTENTS
+			|| (n == INODE_DIRECT_EXTENTS && e->count == 1))
+		inode->ind_dirty = true;
+	inode->dirty = true;
+	return true;
+}
+
+/* Makes sure INODE's data reaches byte offset POS, appending
+ * clusters as needed.  New clusters are marked unwritten instead of
+ * being zeroed on disk; the first write to each one clears the mark.
+ * Returns false if the disk is full. */
+static bool
+inode_extend_chain (struct inode *inode, off_t pos) {
+	size_t need = pos / cluster_bytes () + 1;
+	size_t have = 0;
+	cluster_t clst = 0;
+	bool chained = inode->data.start != 0 && inode->data.extent_cnt == 0;
+
+	if (chained) {
+		clst = sector_to_cluster (inode->data.start);
+		for (have = 1; have < need; have++) {
+			cluster_t next = fat_get (clst);
+			if (next == EOChain || next == 0)
+				break;
+			clst = next;
+		}
+	} else {
+		for (size_t i = 0; i < inode->data.extent_cnt; i++) {
+			struct inode_extent *e = extent_at (inode, i);
+			have += e->count;
+			clst = e->start + e->count - 1;
+		}
+	}
+
+	/* An overwrite within the clusters the file already has. */
+	if (have >= need)
+		return true;
+
+	/* Take everything still missing as one contiguous run if the disk
+	 * has one; otherwise fall back to a cluster at a time. */
+	cluster_t run = need > have + 1 ? fat_create_run (clst, need - have) : 0;
+	for (; have < need; have++) {
+		cluster_t next = run != 0 ? run++ : fat_create_chain (clst);
+		if (next == 0)
+			return false;
+		if (run == 0)
+			fat_set_unwritten (next, true);
+		if (clst != 0)
+			note_fat_change (inode, clst);
+		note_fat_change (inode, next);
+		if (clst == 0)
+			inode->data.start = cluster_to_sector (next);
+		if (!chained && !extent_append (inode, next)) {
+			extents_drop (inode);
+			chained = true;
+		}
+		clst = next;
+	}
+	return true;
+}
+
+/* Returns how many sectors, starting with SECTOR at byte OFFSET of
+ * INODE, one multi-sector transfer can cover: whole sectors within
+ * the SIZE bytes requested and the file, physically consecutive,
+ * unwritten exactly when HOLE is, and not held in the write buffer.
+ * SECTOR itself always counts. */
+static size_t
+sector_run (struct inode *inode, disk_sector_t sector, off_t offset,
+		off_t size, bool hole) {
+	off_t left = inode_length (inode) - offset;
+	size_t limit = (size < left ? size : left) / DISK_SECTOR_SIZE;
+	size_t cnt = 1;
+
+	if (limit > DISK_MAX_MULTI)
+		limit = DISK_MAX_MULTI;
+	while (cnt < limit) {
+		disk_sector_t next = byte_to_sector (inode,
+				offset + (off_t) cnt * DISK_SECTOR_SIZE);
+		if (next != sector + cnt || sector_is_hole (next) != hole
+				|| (inode->wbuf_valid && next == inode->wbuf_sector))
+			break;
+		cnt++;
+	}
+	return cnt;
+}
+
+/* Clears the unwritten mark of INODE's cluster holding SECTOR, which
+ * the caller has just written.  The whole cluster then reads from
+ * disk, so when it spans several sectors the others are zeroed first,
+ * except the FILLED sectors right after SECTOR that the caller is
+ * about to overwrite completely. */
+static void
+cluster_mark_written (struct inode *inode, disk_sector_t sector,
+		size_t filled) {
+	static char zeros[DISK_SECTOR_SIZE];
+	cluster_t clst = sector_to_cluster (sector);
+	unsigned spc = fat_sectors_per_cluster ();
+
+	if (spc > 1) {
+		disk_sector_t first = cluster_to_sector (clst);
+		for (disk_sector_t s = first; s < first + spc; s++)
+			if (s < sector || s > sector + filled)
+				data_write (inode, s, 1, zeros);
+	}
+	fat_set_unwritten (clst, false);
+	note_fat_change (inode, clst);
+}
+
+/* Moves INODE's inline data out to a newly allocated cluster, so the
+ * file can grow past INODE_INLINE_MAX.  Returns false if the disk is
+ * full, leaving INODE inline. */
+static bool
+inode_promote_inline (struct inode *inode) {
+	off_t length = inode->data.length;
+	uint8_t *bounce = calloc (1, DISK_SECTOR_SIZE);
+
+	if (bounce == NULL)
+		return false;
+	memcpy (bounce, inode->data.inline_data, INODE_INLINE_MAX);
+
+	memset (inode->data.extents, 0, sizeof inode->data.extents);
+	inode->data.is_inline = false;
+	inode->data.extent_cnt = 0;
+	inode->data.start = 0;
+	inode->dirty = true;
+
+	if (length > 0) {
+		disk_sector_t sector;
+
+		if (!inode_extend_chain (inode, length - 1)) {
+			memcpy (inode->data.inline_data, bounce, INODE_INLINE_MAX);
+			inode->data.is_inline = true;
+			free (bounce);
+			return false;
+		}
+		sector = byte_to_sector (inode, 0);
+		data_write (inode, sector, 1, bounce);
+		cluster_mark_written (inode, sector, 0);
+	}
+	free (bounce);
+	return true;
+}
+#endif
+
 /* List of open inodes, so that opening a single inode twice
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and every inode's open_cnt, loading and
+ * closing.  Never held across disk I/O. */
+static struct lock open_inodes_lock;
+
+/* Signaled when an inode finishes loading or leaves open_inodes. */
+static struct condition inode_settled;
+
+/* Serializes inode_flush_all(), which owns every flush_elem. */
+static struct lock flush_all_lock;
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	lock_init (&open_inodes_lock);
+	cond_init (&inode_settled);
+	lock_init (&flush_all_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -80,39 +387,21 @@ inode_create (disk_sector_t sector, off_t length, bool is_dir) {
 
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
-		/*길이 length만큼 저장 시 필요한 sector 수 반환*/
-		size_t sectors = bytes_to_sectors (length);
 		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
 		disk_inode->is_dir = is_dir;
 		#ifdef EFILESYS
-			/* 파일의 첫번째 클러스터 번호 받기 */
-			cluster_t start = fat_create_chain(0);
-			if (!start) {
-				free(disk_inode);
-				return false;
-			}
-			/* disk_inode->start에 inode를 가리키는 파일의 첫번째 섹터번호 저장 */
-			disk_inode->start = cluster_to_sector(start);
-			/* disk_inode를 inode 섹터번호위치에 write */
-			disk_write (filesys_disk, sector, disk_inode);
-
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-
-				size_t i;
-				cluster_t clst = start;
-				disk_write (filesys_disk, cluster_to_sector(start), zeros);
-
-				/* file길이만큼의 sectors에 zeros로 초기화*/
-				for (i = 0; i < sectors - 1; i++) {
-					clst = fat_create_chain(clst);
-					disk_write (filesys_disk, cluster_to_sector(clst), zeros);
-				}
-			}
+			/* Clusters are allocated when data is first written, so
+			 * a new file of any length is one hole that reads as
+			 * zeros; only the inode sector itself is written. */
+			disk_inode->start = 0;
+			disk_inode->is_inline = length <= (off_t) INODE_INLINE_MAX;
+			journal_write (sector, disk_inode);
 			success = true;
 
 		#else
+			/*길이 length만큼 저장 시 필요한 sector 수 반환*/
+			size_t sectors = bytes_to_sectors (length);
 			if (free_map_allocate (sectors, &disk_inode->start)) {
 				disk_write (filesys_disk, sector, disk_inode);
 				if (sectors > 0) {
@@ -131,6 +420,27 @@ inode_create (disk_sector_t sector, off_t length, bool is_dir) {
 }
 
 
+/* Returns the inode for SECTOR in open_inodes, or a null pointer,
+ * first waiting for one being closed to leave the list.  Must be
+ * called with open_inodes_lock held. */
+static struct inode *
+find_open (disk_sector_t sector) {
+	struct list_elem *e = list_begin (&open_inodes);
+
+	while (e != list_end (&open_inodes)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+
+		if (inode->sector != sector)
+			e = list_next (e);
+		else if (inode->closing) {
+			cond_wait (&inode_settled, &open_inodes_lock);
+			e = list_begin (&open_inodes);
+		} else
+			return inode;
+	}
+	return NULL;
+}
+
 /* Reads an inode from SECTOR
  * and returns a `struct inode' that contains it.
  * Returns a null pointer if memory allocation fails. */
@@ -140,39 +450,79 @@ inode_create (disk_sector_t sector, off_t length, bool is_dir) {
 /* 파일과 디렉토리 모두 inode를 하나씩 가리키는 inode 포인터를 가지고 있다 */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
 	struct inode *inode;
+	struct inode_extent *ind;
 
-	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
+	lock_acquire (&open_inodes_lock);
+
+	/* Check whether this inode is already open.  If another opener
+	 * is still reading it, wait for that instead of reading it too. */
+	inode = find_open (sector);
+	if (inode != NULL) {
+		inode->open_cnt++;
+		while (inode->loading)
+			cond_wait (&inode_settled, &open_inodes_lock);
+		lock_release (&open_inodes_lock);
+		return inode;
 	}
 
-	/* Allocate memory. */
+	/* Allocate memory, with room for indirect extents in case the
+	 * inode turns out to have them. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	ind = malloc (DISK_SECTOR_SIZE);
+	if (inode == NULL || ind == NULL) {
+		lock_release (&open_inodes_lock);
+		free (inode);
+		free (ind);
 		return NULL;
+	}
 
-	/* Initialize. */
+	/* Initialize, marked as loading, and read the inode with
+	 * open_inodes_lock dropped so that other opens and closes go on
+	 * meanwhile. */
 	list_push_front (&open_inodes, &inode->elem);
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	inode->dirty = false;
+	rwlock_init (&inode->rwlock);
+	lock_init (&inode->dir_lock);
+	inode->ind_extents = NULL;
+	inode->ind_dirty = false;
+	inode->fat_dirty_cnt = 0;
+	inode->write_gen = 0;
+	inode->wbuf = NULL;
+	inode->wbuf_valid = false;
+	inode->loading = true;
+	inode->closing = false;
+	lock_release (&open_inodes_lock);
+
+	journal_read (inode->sector, &inode->data);
+#ifdef EFILESYS
+	if (inode->data.indirect != 0) {
+		journal_read (inode->data.indirect, ind);
+		inode->ind_extents = ind;
+		ind = NULL;
+	}
+#endif
+	free (ind);
+
+	lock_acquire (&open_inodes_lock);
+	inode->loading = false;
+	cond_broadcast (&inode_settled, &open_inodes_lock);
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -182,6 +532,162 @@ inode_get_inumber (const struct inode *inode) {
 	return inode->sector;
 }
 
+/* Writes the sector in INODE's write-combining buffer to disk, if
+ * there is one.  Must be called with INODE's rwlock held for
+ * writing, or with INODE otherwise unreachable. */
+static void
+wbuf_flush (struct inode *inode) {
+	bool hole;
+
+	if (!inode->wbuf_valid)
+		return;
+	hole = sector_is_hole (inode->wbuf_sector);
+	data_write (inode, inode->wbuf_sector, 1, inode->wbuf);
+#ifdef EFILESYS
+	if (hole)
+		cluster_mark_written (inode, inode->wbuf_sector, 0);
+#else
+	(void) hole;
+#endif
+	inode->wbuf_valid = false;
+}
+
+/* Makes INODE's write-combining buffer hold SECTOR, flushing the
+ * sector it held before and loading SECTOR's current contents.
+ * Returns false if out of memory. */
+static bool
+wbuf_load (struct inode *inode, disk_sector_t sector) {
+	if (inode->wbuf_valid && inode->wbuf_sector == sector)
+		return true;
+
+	wbuf_flush (inode);
+	if (inode->wbuf == NULL) {
+		inode->wbuf = malloc (DISK_SECTOR_SIZE);
+		if (inode->wbuf == NULL)
+			return false;
+	}
+	if (sector_is_hole (sector))
+		memset (inode->wbuf, 0, DISK_SECTOR_SIZE);
+	else
+		data_read (inode, sector, 1, inode->wbuf);
+	inode->wbuf_sector = sector;
+	inode->wbuf_valid = true;
+	return true;
+}
+
+/* Writes INODE's buffered data, then its metadata if that changed
+ * since it was read or last written, back to disk.  Must be called
+ * with INODE's rwlock held, or by inode_close() once no one else has
+ * INODE open. */
+static void
+write_back (struct inode *inode) {
+	if (inode->removed) {
+		inode->wbuf_valid = false;
+		return;
+	}
+	wbuf_flush (inode);
+	if (inode->ind_dirty) {
+		journal_write (inode->data.indirect, inode->ind_extents);
+		inode->ind_dirty = false;
+	}
+	if (inode->dirty) {
+		journal_write (inode->sector, &inode->data);
+		inode->dirty = false;
+	}
+}
+
+/* Writes INODE's metadata to disk now, if it is dirty.  With a
+ * journal this is an operation of its own, so the running
+ * transaction keeps room for it. */
+void
+inode_flush (struct inode *inode) {
+	journal_begin ();
+	rwlock_acquire_write (&inode->rwlock);
+	write_back (inode);
+	rwlock_release_write (&inode->rwlock);
+	journal_end ();
+}
+
+/* Makes everything written to INODE so far durable.  File data is
+ * written through already, so what remains is the FAT sectors that
+ * record INODE's clusters, in sector order, and then INODE's own
+ * metadata; in that order the inode on disk never refers to a
+ * cluster the on-disk FAT does not have allocated. */
+void
+inode_sync (struct inode *inode) {
+	if (journal_enabled ()) {
+		/* One commit carries the inode and the FAT sectors together,
+		 * so there is no order to keep among them. */
+		journal_begin ();
+		rwlock_acquire_write (&inode->rwlock);
+		write_back (inode);
+#ifdef EFILESYS
+		inode->fat_dirty_cnt = 0;
+#endif
+		rwlock_release_write (&inode->rwlock);
+		journal_end ();
+		journal_commit ();
+		return;
+	}
+	rwlock_acquire_write (&inode->rwlock);
+	wbuf_flush (inode);
+#ifdef EFILESYS
+	/* The cluster holding the inode itself, in case it is new. */
+	note_fat_change (inode, sector_to_cluster (inode->sector));
+	if (inode->fat_dirty_cnt < 0)
+		fat_flush ();
+	else {
+		unsigned *idx = inode->fat_dirty;
+		int n = inode->fat_dirty_cnt;
+
+		for (int i = 1; i < n; i++)
+			for (int j = i; j > 0 && idx[j - 1] > idx[j]; j--) {
+				unsigned t = idx[j];
+				idx[j] = idx[j - 1];
+				idx[j - 1] = t;
+			}
+		for (int i = 0; i < n; i++)
+			fat_flush_sector (idx[i]);
+	}
+	inode->fat_dirty_cnt = 0;
+#endif
+	write_back (inode);
+	rwlock_release_write (&inode->rwlock);
+}
+
+/* Writes back the metadata of every open inode that is dirty.  The
+ * inodes are gathered, each with a reference held, and then written
+ * one by one under their own rwlocks, so open_inodes_lock is not held
+ * across any of the writes. */
+void
+inode_flush_all (void) {
+	struct list flush;
+	struct list_elem *e;
+
+	lock_acquire (&flush_all_lock);
+	list_init (&flush);
+	lock_acquire (&open_inodes_lock);
+	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+			e = list_next (e)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+
+		if (!inode->loading && !inode->closing) {
+			inode->open_cnt++;
+			list_push_back (&flush, &inode->flush_elem);
+		}
+	}
+	lock_release (&open_inodes_lock);
+
+	while (!list_empty (&flush)) {
+		struct inode *inode = list_entry (list_pop_front (&flush),
+				struct inode, flush_elem);
+
+		inode_flush (inode);
+		inode_close (inode);
+	}
+	lock_release (&flush_all_lock);
+}
+
 /* Closes INODE and writes it to disk.
  * If this was the last reference to INODE, frees its memory.
  * If INODE was also a removed inode, frees its blocks. */
@@ -194,23 +700,51 @@ inode_close (struct inode *inode) {
 	if (inode == NULL)
 		return;
 
-	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
-		disk_write(filesys_disk, inode->sector, &inode->data);
-
-		/* Deallocate blocks if removed. */
-		if (inode->removed) {
-			// free_map_release (inode->sector, 1);
-			// free_map_release (inode->data.start,
-			// 		bytes_to_sectors (inode->data.length)); 
-			fat_remove_chain(sector_to_cluster(inode->sector), 0);
-			fat_remove_chain(sector_to_cluster(inode->data.start), 0);
-		}
+	/* Release resources if this was the last opener.  A dirty inode
+	 * is written back before leaving the list, marked as closing, so
+	 * a concurrent inode_open() of the same sector waits instead of
+	 * reading a stale copy.  open_inodes_lock is not held across the
+	 * write. */
+	lock_acquire (&open_inodes_lock);
+	if (--inode->open_cnt > 0) {
+		lock_release (&open_inodes_lock);
+		return;
+	}
+	inode->closing = true;
+	lock_release (&open_inodes_lock);
+
+	/* Only a dirty inode needs a journal handle, which callers
+	 * holding a directory's dir_lock must not wait for. */
+	if (!inode->removed
+			&& (inode->dirty || inode->ind_dirty || inode->wbuf_valid)) {
+		journal_begin ();
+		write_back (inode);
+		journal_end ();
+	} else
+		write_back (inode);
+
+	lock_acquire (&open_inodes_lock);
+	list_remove (&inode->elem);
+	cond_broadcast (&inode_settled, &open_inodes_lock);
+	lock_release (&open_inodes_lock);
 
-		free (inode); 
+	/* Deallocate blocks if removed. */
+	if (inode->removed) {
+		dcache_purge (inode->sector);
+		// free_map_release (inode->sector, 1);
+		// free_map_release (inode->data.start,
+		// 		bytes_to_sectors (inode->data.length)); 
+		fat_remove_chain(sector_to_cluster(inode->sector), 0);
+		fat_count_inode (-1);
+		if (inode->data.start != 0)
+			fat_remove_chain(sector_to_cluster(inode->data.start), 0);
+		if (inode->data.indirect != 0)
+			fat_remove_chain(sector_to_cluster(inode->data.indirect), 0);
 	}
+
+	free (inode->ind_extents);
+	free (inode->wbuf);
+	free (inode); 
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -223,13 +757,25 @@ inode_remove (struct inode *inode) {
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
-off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
+ * than SIZE if an error occurs or end of file is reached.
+ * The caller must hold INODE's rwlock. */
+static off_t
+read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
 
+#ifdef EFILESYS
+	if (inode->data.is_inline) {
+		if (offset < inode->data.length) {
+			bytes_read = inode->data.length - offset;
+			if (size < bytes_read)
+				bytes_read = size;
+			memcpy (buffer, inode->data.inline_data + offset, bytes_read);
+		}
+		return bytes_read;
+	}
+#endif
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		// printf("!!!!!=========byte_to_sector 진입전 inode->data.length : %d \n",inode->data.length);
@@ -246,9 +792,18 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
+		if (inode->wbuf_valid && sector_idx == inode->wbuf_sector) {
+			/* Newer than the disk: still in the write buffer. */
+			memcpy (buffer + bytes_read, inode->wbuf + sector_ofs, chunk_size);
+		} else if (sector_is_hole (sector_idx)) {
+			/* Nothing written here yet: zeros, no disk read. */
+			memset (buffer + bytes_read, 0, chunk_size);
+		} else if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
+			/* Read full sectors directly into caller's buffer, as
+			 * many as lie back to back on disk in one command. */
+			size_t cnt = sector_run (inode, sector_idx, offset, size, false);
+			data_read (inode, sector_idx, cnt, buffer + bytes_read);
+			chunk_size = cnt * DISK_SECTOR_SIZE;
 		} else {
 			/* Read sector into bounce buffer, then partially copy
 			 * into caller's buffer. */
@@ -257,7 +812,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 				if (bounce == NULL)
 					break;
 			}
-			disk_read (filesys_disk, sector_idx, bounce);
+			data_read (inode, sector_idx, 1, bounce);
 			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
 		}
 
@@ -271,39 +826,47 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
- * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
-/* 파일의 현재 위치인 inode에서 SIZE 바이트를 BUFFER로 씁니다.*/
-off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+ * growing INODE as needed.  Returns the number of bytes actually
+ * written, which may be less than SIZE if the disk fills up.
+ * The caller must hold INODE's rwlock for writing. */
+static off_t
+write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
-	uint8_t zero[512];
-	memset(zero, 0, DISK_SECTOR_SIZE);
-	if (inode->deny_write_cnt)
-		return 0;
 
-	#ifdef EFILESYS
-		disk_sector_t sect = byte_to_sector(inode, offset + size);
-		disk_sector_t sectors;
-
-		if (sect == -1) {
-			sectors = DIV_ROUND_UP(offset + size - inode->data.length, 512);
-			cluster_t clst = sector_to_cluster(byte_to_sector(inode, inode_length(inode) - 1));
-			for (int i = 0; i < sectors; i++) {
-				clst = fat_create_chain(clst);
-				if(clst == 0) {
-					break;
-				}
-				disk_write(filesys_disk, cluster_to_sector(clst), zero);
+	inode->write_gen++;
 
+	#ifdef EFILESYS
+		if (inode->data.is_inline && size > 0) {
+			if (offset + size <= (off_t) INODE_INLINE_MAX) {
+				memcpy (inode->data.inline_data + offset, buffer, size);
+				if (offset + size > inode->data.length)
+					inode->data.length = offset + size;
+				inode->dirty = true;
+				return size;
 			}
-			inode->data.length = offset + size;
+			if (!inode_promote_inline (inode))
+				return 0;
+		}
+
+		/* Reserve clusters up to the last byte written.  Clusters
+		 * skipped over stay unwritten, so seeking far past the end
+		 * and writing costs no zero-fill I/O. */
+		if (size > 0) {
+			disk_sector_t old_start = inode->data.start;
+			off_t old_length = inode->data.length;
+			if (!inode_extend_chain (inode, offset + size - 1))
+				return 0;
+			if (offset + size > inode->data.length)
+				inode->data.length = offset + size;
+
+			/* Only a changed start or length needs the inode sector
+			 * rewritten, and that is deferred to close or sync. */
+			if (inode->data.start != old_start
+					|| inode->data.length != old_length)
+				inode->dirty = true;
 		}
 
 	#endif
@@ -325,25 +888,36 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 				break;
 
 			if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-				/* Write full sector directly to disk. */
-				disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
+				/* Write full sectors directly to disk, as many as lie
+				 * back to back in one command.  They supersede anything
+				 * buffered for the first of them. */
+				bool hole = sector_is_hole (sector_idx);
+				size_t cnt = sector_run (inode, sector_idx, offset, size, hole);
+				if (inode->wbuf_valid && inode->wbuf_sector == sector_idx)
+					inode->wbuf_valid = false;
+				data_write (inode, sector_idx, cnt, buffer + bytes_written);
+				chunk_size = cnt * DISK_SECTOR_SIZE;
+			#ifdef EFILESYS
+				/* Each cluster the run reached is now written. */
+				if (hole)
+					for (size_t i = 0; i < cnt; i++) {
+						disk_sector_t s = sector_idx + i;
+						if (i == 0 || sector_to_cluster (s) != sector_to_cluster (s - 1))
+							cluster_mark_written (inode, s,
+									(size - (off_t) i * DISK_SECTOR_SIZE)
+									/ DISK_SECTOR_SIZE - 1);
+					}
+			#endif
 			} else {
-				/* We need a bounce buffer. */
-				if (bounce == NULL) {
-					bounce = malloc (DISK_SECTOR_SIZE);
-					if (bounce == NULL)
-						break;
-				}
-
-				/* If the sector contains data before or after the chunk
-				we're writing, then we need to read in the sector
-				first.  Otherwise we start with a sector of all zeros. */
-				if (sector_ofs > 0 || chunk_size < sector_left) 
-					disk_read (filesys_disk, sector_idx, bounce);
-				else
-					memset (bounce, 0, DISK_SECTOR_SIZE);
-				memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-				disk_write (filesys_disk, sector_idx, bounce); 
+				/* Merge into the write-combining buffer.  The sector
+				 * goes to disk once the write reaches its end, or when
+				 * the buffer is needed for another sector or flushed,
+				 * so a run of small writes costs one disk write. */
+				if (!wbuf_load (inode, sector_idx))
+					break;
+				memcpy (inode->wbuf + sector_ofs, buffer + bytes_written, chunk_size);
+				if (sector_ofs + chunk_size == DISK_SECTOR_SIZE)
+					wbuf_flush (inode);
 			}
 
 			/* Advance. */
@@ -352,19 +926,438 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 			bytes_written += chunk_size;
 		}
 
-	free (bounce);
-	disk_write (filesys_disk, inode->sector, &inode->data);
+	return bytes_written;
+}
+
+/* Most bytes moved through a kernel buffer per step when the
+ * caller's buffers are in user memory.  Touching user memory may
+ * fault, and the fault may read or write this very inode (through
+ * mmap), so it is never done with the inode's rwlock held.  Reads
+ * and writes of up to this size are still a single operation. */
+#define BOUNCE_SIZE (16 * PGSIZE)
+
+/* Returns true if any of the CNT buffers of IOV is in user memory. */
+static bool
+iov_is_user (const struct iovec *iov, int cnt) {
+	for (int i = 0; i < cnt; i++)
+		if (iov[i].iov_len > 0 && is_user_vaddr (iov[i].iov_base))
+			return true;
+	return false;
+}
+
+/* Returns the total size of the CNT buffers of IOV. */
+static size_t
+iov_size (const struct iovec *iov, int cnt) {
+	size_t size = 0;
+
+	for (int i = 0; i < cnt; i++)
+		size += iov[i].iov_len;
+	return size;
+}
+
+/* Copies SIZE bytes between BUF and the buffers of IOV, into IOV if
+ * TO_IOV, else out of it, starting at byte *OFS of buffer *I and
+ * advancing both. */
+static void
+iov_copy (const struct iovec *iov, int *i, size_t *ofs, uint8_t *buf,
+		size_t size, bool to_iov) {
+	while (size > 0) {
+		size_t n = iov[*i].iov_len - *ofs;
+		uint8_t *p = (uint8_t *) iov[*i].iov_base + *ofs;
+
+		if (n > size)
+			n = size;
+		if (to_iov)
+			memcpy (p, buf, n);
+		else
+			memcpy (buf, p, n);
+		buf += n;
+		size -= n;
+		*ofs += n;
+		if (*ofs == iov[*i].iov_len) {
+			++*i;
+			*ofs = 0;
+		}
+	}
+}
+
+/* Allocates a bounce buffer for a transfer of SIZE bytes and stores
+ * its size in *CAP.  Returns NULL if memory runs out. */
+static uint8_t *
+bounce_alloc (size_t size, size_t *cap) {
+	size_t pages = DIV_ROUND_UP (size < BOUNCE_SIZE ? size : BOUNCE_SIZE,
+			PGSIZE);
 
+	*cap = pages * PGSIZE;
+	return palloc_get_multiple (0, pages);
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
+ * Returns the number of bytes actually read, which may be less
+ * than SIZE if an error occurs or end of file is reached. */
+off_t
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) {
+	off_t bytes_read;
+
+	if (size > 0 && is_user_vaddr (buffer)) {
+		struct iovec iov = { buffer, size };
+		return inode_read_iov (inode, &iov, 1, offset);
+	}
+	rwlock_acquire_read (&inode->rwlock);
+	bytes_read = read_at (inode, buffer, size, offset);
+	rwlock_release_read (&inode->rwlock);
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * Returns the number of bytes actually written, which may be
+ * less than SIZE if the disk fills up or writes are denied. */
+/* 파일의 현재 위치인 inode에서 SIZE 바이트를 BUFFER로 씁니다.*/
+off_t
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+		off_t offset) {
+	off_t bytes_written = 0;
+
+	if (size > 0 && is_user_vaddr (buffer)) {
+		struct iovec iov = { (void *) buffer, size };
+		return inode_write_iov (inode, &iov, 1, offset);
+	}
+	rwlock_acquire_write (&inode->rwlock);
+	if (!inode->deny_write_cnt)
+		bytes_written = write_at (inode, buffer, size, offset);
+	rwlock_release_write (&inode->rwlock);
 	return bytes_written;
 }
 
+/* Reads into the CNT buffers of IOV in turn, starting at OFFSET in
+ * INODE, as one operation: no write to INODE can land in between.
+ * Reads into user memory larger than BOUNCE_SIZE are made of several
+ * such operations.  Stops at end of file.  Returns the number of
+ * bytes read. */
+off_t
+inode_read_iov (struct inode *inode, const struct iovec *iov, int cnt,
+		off_t offset) {
+	off_t total = 0;
+
+	if (iov_is_user (iov, cnt)) {
+		size_t left = iov_size (iov, cnt), cap, ofs = 0;
+		uint8_t *bounce = bounce_alloc (left, &cap);
+		int i = 0;
+
+		if (bounce == NULL)
+			return 0;
+		while (left > 0) {
+			size_t step = left < cap ? left : cap;
+			off_t n;
+
+			rwlock_acquire_read (&inode->rwlock);
+			n = read_at (inode, bounce, step, offset);
+			rwlock_release_read (&inode->rwlock);
+			iov_copy (iov, &i, &ofs, bounce, n, true);
+			total += n;
+			offset += n;
+			left -= n;
+			if ((size_t) n < step)
+				break;
+		}
+		palloc_free_multiple (bounce, cap / PGSIZE);
+		return total;
+	}
+
+	rwlock_acquire_read (&inode->rwlock);
+	for (int i = 0; i < cnt; i++) {
+		off_t n = read_at (inode, iov[i].iov_base, iov[i].iov_len, offset);
+		total += n;
+		offset += n;
+		if (n < (off_t) iov[i].iov_len)
+			break;
+	}
+	rwlock_release_read (&inode->rwlock);
+	return total;
+}
+
+/* Writes the CNT buffers of IOV in turn into INODE, starting at
+ * OFFSET, as one operation, or several of up to BOUNCE_SIZE bytes
+ * each when they are in user memory.  Returns the number of bytes
+ * written. */
+off_t
+inode_write_iov (struct inode *inode, const struct iovec *iov, int cnt,
+		off_t offset) {
+	off_t total = 0;
+
+	if (iov_is_user (iov, cnt)) {
+		size_t left = iov_size (iov, cnt), cap, ofs = 0;
+		uint8_t *bounce = bounce_alloc (left, &cap);
+		int i = 0;
+
+		if (bounce == NULL)
+			return 0;
+		while (left > 0) {
+			size_t step = left < cap ? left : cap;
+			off_t n = 0;
+
+			iov_copy (iov, &i, &ofs, bounce, step, false);
+			rwlock_acquire_write (&inode->rwlock);
+			if (!inode->deny_write_cnt)
+				n = write_at (inode, bounce, step, offset);
+			rwlock_release_write (&inode->rwlock);
+			total += n;
+			offset += n;
+			left -= n;
+			if ((size_t) n < step)
+				break;
+		}
+		palloc_free_multiple (bounce, cap / PGSIZE);
+		return total;
+	}
+
+	rwlock_acquire_write (&inode->rwlock);
+	if (!inode->deny_write_cnt) {
+		for (int i = 0; i < cnt; i++) {
+			off_t n = write_at (inode, iov[i].iov_base, iov[i].iov_len, offset);
+			total += n;
+			offset += n;
+			if (n < (off_t) iov[i].iov_len)
+				break;
+		}
+	}
+	rwlock_release_write (&inode->rwlock);
+	return total;
+}
+
+/* Reserves clusters for bytes [OFFSET, OFFSET + LEN) of INODE without
+ * writing them, and extends INODE's length to cover the range.  The
+ * clusters are taken as one contiguous run when possible and stay
+ * unwritten, reading as zeros, until data is written to them.
+ * Returns false if the disk is full or writes are denied. */
+bool
+inode_allocate (struct inode *inode, off_t offset, off_t len) {
+	off_t end = offset + len;
+	bool success = false;
+
+	ASSERT (offset >= 0 && len > 0);
+
+	rwlock_acquire_write (&inode->rwlock);
+	if (inode->deny_write_cnt)
+		goto done;
+#ifdef EFILESYS
+	if (inode->data.is_inline) {
+		if (end > (off_t) INODE_INLINE_MAX && !inode_promote_inline (inode))
+			goto done;
+	}
+	if (!inode->data.is_inline && !inode_extend_chain (inode, end - 1))
+		goto done;
+	if (end > inode->data.length) {
+		inode->data.length = end;
+		inode->write_gen++;
+	}
+	inode->dirty = true;
+	success = true;
+#else
+	/* Files cannot grow without EFILESYS. */
+	success = end <= inode->data.length;
+#endif
+done:
+	rwlock_release_write (&inode->rwlock);
+	return success;
+}
+
+#ifdef EFILESYS
+/* Returns a newly allocated array of INODE's data clusters, in file
+ * order, and stores their number in *CNT.  Returns a null pointer
+ * if out of memory.  The caller must hold INODE's rwlock. */
+static cluster_t *
+inode_clusters (struct inode *inode, size_t *cnt) {
+	size_t n = 0, cap = 16;
+	cluster_t *clsts = malloc (cap * sizeof *clsts);
+
+	if (clsts == NULL)
+		return NULL;
+	if (inode->data.extent_cnt > 0) {
+		for (size_t i = 0; i < inode->data.extent_cnt; i++) {
+			struct inode_extent *e = extent_at (inode, i);
+			for (uint32_t j = 0; j < e->count; j++) {
+				if (n == cap) {
+					cluster_t *p = realloc (clsts, 2 * cap * sizeof *clsts);
+					if (p == NULL)
+						goto fail;
+					clsts = p;
+					cap *= 2;
+				}
+				clsts[n++] = e->start + j;
+			}
+		}
+	} else {
+		cluster_t clst = sector_to_cluster (inode->data.start);
+		while (clst != EOChain && clst != 0) {
+			if (n == cap) {
+				cluster_t *p = realloc (clsts, 2 * cap * sizeof *clsts);
+				if (p == NULL)
+					goto fail;
+				clsts = p;
+				cap *= 2;
+			}
+			clsts[n++] = clst;
+			clst = fat_get (clst);
+		}
+	}
+	*cnt = n;
+	return clsts;
+
+fail:
+	free (clsts);
+	return NULL;
+}
+
+/* Returns the number of physically contiguous runs among the CNT
+ * clusters in CLSTS. */
+static size_t
+count_runs (const cluster_t *clsts, size_t cnt) {
+	size_t runs = cnt > 0;
+
+	for (size_t i = 1; i < cnt; i++)
+		if (clsts[i] != clsts[i - 1] + 1)
+			runs++;
+	return runs;
+}
+
+/* Returns an upper bound on the metadata sectors that moving the CNT
+ * clusters CLSTS of INODE to a new run writes: the FAT sectors holding
+ * their entries and the new run's, the inode and its indirect block,
+ * and for a directory, whose contents are metadata too, every sector
+ * of the new run. */
+static size_t
+defrag_sectors (const struct inode *inode, const cluster_t *clsts,
+		size_t cnt) {
+	size_t sectors = cnt / (DISK_SECTOR_SIZE / sizeof (cluster_t)) + 2 + 2;
+
+	for (size_t i = 0; i < cnt; i++)
+		if (i == 0 || fat_sector_of (clsts[i]) != fat_sector_of (clsts[i - 1]))
+			sectors++;
+	if (inode->data.is_dir)
+		sectors += cnt * fat_sectors_per_cluster ();
+	return sectors;
+}
+
+/* Copies INODE's CNT data clusters CLSTS to the contiguous run
+ * starting at DST, which was allocated unwritten.  Clusters never
+ * written stay that way.  Returns false if out of memory. */
+static bool
+copy_clusters (struct inode *inode, const cluster_t *clsts, size_t cnt,
+		cluster_t dst) {
+	unsigned spc = fat_sectors_per_cluster ();
+	uint8_t *buf = malloc (cluster_bytes ());
+
+	if (buf == NULL)
+		return false;
+	for (size_t i = 0; i < cnt; i++) {
+		if (fat_is_unwritten (clsts[i]))
+			continue;
+		data_read (inode, cluster_to_sector (clsts[i]), spc, buf);
+		data_write (inode, cluster_to_sector (dst + i), spc, buf);
+		fat_set_unwritten (dst + i, false);
+	}
+	free (buf);
+	return true;
+}
+#endif
+
+/* Moves INODE's data into a single run of contiguous clusters, so
+ * that it reads back with few, large transfers.  Safe while INODE is
+ * open elsewhere: readers and writers wait on INODE's rwlock.  The
+ * new copy and its FAT entries reach the disk before the inode is
+ * switched to it, and the old clusters are freed only after that, so
+ * a crash at any point leaves either copy intact, at worst leaking
+ * clusters.  With a journal, the switch and the frees commit as one
+ * transaction.  Stores the number of fragments before and after in
+ * *BEFORE and *AFTER.  Returns false, leaving INODE as it was, if no
+ * free run is long enough, the move is too large for one journal
+ * operation, or memory runs out. */
+bool
+inode_defrag (struct inode *inode, size_t *before, size_t *after) {
+	bool success = true;
+
+	*before = *after = 0;
+#ifdef EFILESYS
+	cluster_t *clsts = NULL;
+	disk_sector_t old_indirect;
+	size_t cnt;
+	cluster_t run;
+
+	journal_begin ();
+	rwlock_acquire_write (&inode->rwlock);
+	if (inode->removed || inode->data.is_inline || inode->data.start == 0)
+		goto done;
+
+	/* Buffered data must reach the old clusters before they are
+	 * copied. */
+	wbuf_flush (inode);
+	clsts = inode_clusters (inode, &cnt);
+	if (clsts == NULL) {
+		success = false;
+		goto done;
+	}
+	*before = *after = count_runs (clsts, cnt);
+	if (*before <= 1)
+		goto done;
+
+	/* The whole move must fit one journal operation. */
+	if (journal_enabled ()
+			&& defrag_sectors (inode, clsts, cnt) > JOURNAL_HANDLE_BLOCKS) {
+		success = false;
+		goto done;
+	}
+
+	run = fat_create_run (0, cnt);
+	if (run == 0) {
+		success = false;
+		goto done;
+	}
+	if (!copy_clusters (inode, clsts, cnt, run)) {
+		fat_remove_chain (run, 0);
+		success = false;
+		goto done;
+	}
+	fat_flush ();
+
+	/* Point the inode at the copy, as a single extent. */
+	old_indirect = inode->data.indirect;
+	free (inode->ind_extents);
+	inode->ind_extents = NULL;
+	inode->ind_dirty = false;
+	inode->data.indirect = 0;
+	inode->data.start = cluster_to_sector (run);
+	inode->data.extent_cnt = 1;
+	inode->data.extents[0].start = run;
+	inode->data.extents[0].count = cnt;
+	inode->dirty = true;
+	inode->write_gen++;
+	write_back (inode);
+
+	fat_remove_chain (clsts[0], 0);
+	if (old_indirect != 0)
+		fat_remove_chain (sector_to_cluster (old_indirect), 0);
+	*after = 1;
+
+done:
+	rwlock_release_write (&inode->rwlock);
+	journal_end ();
+	free (clsts);
+#else
+	(void) inode;
+#endif
+	return success;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
 inode_deny_write (struct inode *inode) 
 {
+	rwlock_acquire_write (&inode->rwlock);
 	inode->deny_write_cnt++;
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+	rwlock_release_write (&inode->rwlock);
 }
 
 /* Re-enables writes to INODE.
@@ -372,9 +1365,18 @@ inode_deny_write (struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write (struct inode *inode) {
+	rwlock_acquire_write (&inode->rwlock);
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+	rwlock_release_write (&inode->rwlock);
+}
+
+/* Returns a counter that changes whenever INODE's data is written, so
+ * that copies of the data made elsewhere can tell they are stale. */
+unsigned
+inode_write_gen (const struct inode *inode) {
+	return inode->write_gen;
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -384,15 +1386,8 @@ inode_length (const struct inode *inode) {
 }
 
 /*project 4*/
+/* Returns true if INODE is a directory.  Answered from the in-memory
+ * copy of the inode, which is always current. */
 bool inode_is_dir (const struct inode *inode) {
-	bool result;
-	
-
-	struct inode_disk *disk_inode = NULL;
-	disk_inode = calloc (1, sizeof *disk_inode);
-	disk_read(filesys_disk ,inode->sector, disk_inode);
-	result = inode->data.is_dir;
-	free(disk_inode);
-	return result;
+	return inode != NULL && inode->data.is_dir;
 }
-
@@ -0,0 +1,587 @@
+/* journal.c: Write-ahead journal of file system metadata.
+ *
+ * Metadata sectors (FAT sectors, inodes, indirect extent blocks and
+ * directory contents) are not written in place as they change.
+ * journal_write() keeps the newest copy of each in the running
+ * transaction, and journal_read() returns it from there, so the
+ * rest of the file system sees its own updates at once.
+ *
+ * journal_commit() turns everything gathered so far into one
+ * transaction (group commit): the blocks are written to the journal
+ * region, then a header that names them and carries their checksum,
+ * which is the commit point.  Only then are the blocks written to
+ * their home sectors, after which the header is cleared.  At mount,
+ * journal_open() replays a committed transaction whose home writes
+ * may not have finished, so recovery reads at most one transaction
+ * instead of checking the whole disk.
+ *
+ * File data is written in place, directly.  It still cannot show up
+ * garbage after a crash: a new cluster stays marked unwritten in the
+ * FAT, and reads as zeros, until its data has reached the disk.
+ *
+ * Operations that change several metadata sectors, such as creating
+ * a file, run between journal_begin() and journal_end(), and a
+ * commit waits for them, so it never captures half of one.  A
+ * transaction always fits the journal in one commit: an operation
+ * starts only if the transaction has room for it and for those
+ * already running, and otherwise waits for them or commits first.
+ * Inodes written back on close or flush take a handle too, so the
+ * only updates made outside one are FAT sectors written back from
+ * the FAT cache.
+ *
+ * A metadata sector whose cluster is freed may be reused for file
+ * data, which bypasses the journal.  journal_forget() drops the
+ * sector's pending copy so that a later checkpoint cannot overwrite
+ * the new data with it. */
+
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/fat.h"
+#include "filesys/filesys.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Identifies journal headers and descriptors. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* Journal region layout: header, descriptor, blocks. */
+#define HEADER_OFS 0
+#define DESC_OFS 1
+#define DESC_SECTORS 2
+#define BLOCKS_OFS (DESC_OFS + DESC_SECTORS)
+
+/* Blocks a transaction may have: as many as the region holds. */
+#define JOURNAL_BLOCKS (JOURNAL_SECTORS - BLOCKS_OFS)
+
+/* Blocks of a transaction left for operations.  The rest of the
+ * journal is kept for the dirty FAT cache and the boot sector, which
+ * join the transaction when it is sealed. */
+#define HANDLE_ROOM (JOURNAL_BLOCKS - (FAT_CACHE_SIZE + 1))
+
+/* Size past which a transaction is committed as soon as possible. */
+#define COMMIT_LIMIT (HANDLE_ROOM - JOURNAL_HANDLE_BLOCKS)
+
+/* First sector of the journal region.  CNT nonzero means the
+ * transaction described at DESC_OFS is committed but its blocks may
+ * not all be home yet. */
+struct journal_header {
+	uint32_t magic;             /* JOURNAL_MAGIC. */
+	uint32_t seq;               /* Sequence number of the last commit. */
+	uint32_t cnt;               /* Blocks awaiting checkpoint, or 0. */
+	uint32_t checksum;          /* Of descriptor and blocks. */
+	uint8_t unused[DISK_SECTOR_SIZE - 4 * sizeof (uint32_t)];
+};
+
+/* Lists the home sector of each block of a transaction. */
+struct journal_desc {
+	uint32_t magic;             /* JOURNAL_MAGIC. */
+	uint32_t seq;               /* Matches the header that commits it. */
+	disk_sector_t sectors[(DESC_SECTORS * DISK_SECTOR_SIZE
+			- 2 * sizeof (uint32_t)) / sizeof (disk_sector_t)];
+};
+
+/* The newest copy of one metadata sector. */
+struct journal_block {
+	struct hash_elem elem;      /* Element in transaction's blocks. */
+	disk_sector_t sector;       /* Home sector. */
+	bool revoked;               /* Freed while being committed? */
+	uint8_t data[DISK_SECTOR_SIZE];
+};
+
+/* A set of metadata updates committed together. */
+struct transaction {
+	struct hash blocks;         /* struct journal_blocks, by sector. */
+	size_t cnt;                 /* Number of blocks. */
+};
+
+bool journal_crash;
+
+static bool enabled;            /* Journal region present and usable? */
+static disk_sector_t region;    /* First sector of the journal region. */
+static uint32_t seq;            /* Sequence number of the last commit. */
+
+/* Staging for commits: descriptor then blocks, contiguous, so that
+ * each goes to the journal in one transfer. */
+static uint8_t *stage;
+static struct journal_header header;
+
+/* Two transactions take turns: one gathers updates while the other
+ * is sealed, written and checkpointed by the committing thread. */
+static struct transaction txns[2];
+static struct transaction *running;     /* Receives journal_write(). */
+static struct transaction *committing;  /* Being committed, or null. */
+static struct thread *committer;        /* Thread sealing COMMITTING. */
+static bool sealing;            /* Committer still adding FAT sectors? */
+
+static struct lock journal_lock;        /* Guards all of the above. */
+static struct lock commit_lock;         /* Serializes commits. */
+static struct lock checkpoint_lock;     /* Held across each home write. */
+static int active;              /* Operations inside begin/end. */
+static bool waiting;            /* A commit is waiting for ACTIVE 0. */
+static struct condition quiet;          /* Signaled when ACTIVE drops to 0. */
+static struct condition resumed;        /* Signaled when WAITING clears or
+                                           an operation ends. */
+static struct semaphore kick;           /* Wakes journald for a commit. */
+static bool kicked;             /* KICK upped for the running transaction? */
+
+static void commit (bool crash);
+
+static uint64_t
+block_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct journal_block, elem)->sector);
+}
+
+static bool
+block_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct journal_block, elem)->sector
+		< hash_entry (b, struct journal_block, elem)->sector;
+}
+
+static void
+block_free (struct hash_elem *e, void *aux UNUSED) {
+	free (hash_entry (e, struct journal_block, elem));
+}
+
+/* Returns T's block for SECTOR, or a null pointer. */
+static struct journal_block *
+txn_find (struct transaction *t, disk_sector_t sector) {
+	struct journal_block key;
+	struct hash_elem *e;
+
+	key.sector = sector;
+	e = hash_find (&t->blocks, &key.elem);
+	return e != NULL ? hash_entry (e, struct journal_block, elem) : NULL;
+}
+
+/* Initializes the journal module.  Until journal_open() or
+ * journal_format() finds a journal region, metadata is read and
+ * written in place. */
+void
+journal_init (void) {
+	lock_init (&journal_lock);
+	lock_init (&commit_lock);
+	lock_init (&checkpoint_lock);
+	cond_init (&quiet);
+	cond_init (&resumed);
+	sema_init (&kick, 0);
+	for (int i = 0; i < 2; i++) {
+		hash_init (&txns[i].blocks, block_hash, block_less, NULL);
+		txns[i].cnt = 0;
+	}
+	running = &txns[0];
+	committing = NULL;
+}
+
+/* Computes the checksum of the descriptor and CNT blocks staged. */
+static uint32_t
+stage_checksum (size_t cnt) {
+	uint32_t h = 2166136261u;
+
+	for (size_t i = 0; i < (DESC_SECTORS + cnt) * DISK_SECTOR_SIZE; i++)
+		h = (h ^ stage[i]) * 16777619u;
+	return h;
+}
+
+/* Writes the header, with CNT blocks awaiting checkpoint, and
+ * CHECKSUM. */
+static void
+write_header (uint32_t cnt, uint32_t checksum) {
+	memset (&header, 0, sizeof header);
+	header.magic = JOURNAL_MAGIC;
+	header.seq = seq;
+	header.cnt = cnt;
+	header.checksum = checksum;
+	disk_write (filesys_disk, region + HEADER_OFS, &header);
+}
+
+/* Writes the CNT blocks staged after the descriptor to their home
+ * sectors, coalescing runs of adjacent sectors into one transfer.
+ * BLOCKS, if nonnull, are the journal blocks staged; one revoked by
+ * journal_forget() is skipped, and checkpoint_lock keeps a run from
+ * being revoked while it is on its way to disk. */
+static void
+checkpoint_stage (size_t cnt, struct journal_block **blocks) {
+	struct journal_desc *desc = (struct journal_desc *) stage;
+
+	for (size_t i = 0; i < cnt;) {
+		size_t n = 0;
+
+		lock_acquire (&checkpoint_lock);
+		if (blocks != NULL)
+			lock_acquire (&journal_lock);
+		while (i + n < cnt && (n == 0
+					|| desc->sectors[i + n] == desc->sectors[i] + n)
+				&& (blocks == NULL || !blocks[i + n]->revoked))
+			n++;
+		if (blocks != NULL)
+			lock_release (&journal_lock);
+		if (n > 0)
+			disk_write_multi (filesys_disk, desc->sectors[i], n,
+					stage + (DESC_SECTORS + i) * DISK_SECTOR_SIZE);
+		lock_release (&checkpoint_lock);
+		i += n > 0 ? n : 1;
+	}
+}
+
+/* Background thread that commits a transaction as soon as it grows
+ * past COMMIT_LIMIT, rather than at the next flush. */
+static void
+journald (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&kick);
+		journal_commit ();
+	}
+}
+
+/* Finds the journal region and sets up staging for it.  Returns
+ * false, leaving the journal disabled, if the disk has none or its
+ * region is smaller than JOURNAL_SECTORS. */
+static bool
+setup_region (void) {
+	size_t sectors;
+
+	enabled = false;
+	if (!fat_journal_region (&region, &sectors) || sectors < JOURNAL_SECTORS)
+		return false;
+	if (stage == NULL) {
+		stage = palloc_get_multiple (0,
+				DIV_ROUND_UP ((JOURNAL_SECTORS - DESC_OFS) * DISK_SECTOR_SIZE,
+					PGSIZE));
+		if (stage == NULL) {
+			printf ("journal: out of memory, metadata written in place\n");
+			return false;
+		}
+		thread_create ("journald", PRI_MAX, journald, NULL);
+	}
+	return true;
+}
+
+/* Mounts the journal of the file system's disk, replaying the last
+ * transaction if it was committed but not completely checkpointed. */
+void
+journal_open (void) {
+	struct journal_desc *desc;
+
+	if (!setup_region ())
+		return;
+
+	disk_read (filesys_disk, region + HEADER_OFS, &header);
+	if (header.magic != JOURNAL_MAGIC) {
+		seq = 0;
+		write_header (0, 0);
+		enabled = true;
+		return;
+	}
+	seq = header.seq;
+	if (header.cnt > 0 && header.cnt <= JOURNAL_BLOCKS) {
+		uint32_t cnt = header.cnt;
+
+		desc = (struct journal_desc *) stage;
+		disk_read_multi (filesys_disk, region + DESC_OFS, DESC_SECTORS + cnt,
+				stage);
+		if (desc->magic == JOURNAL_MAGIC && desc->seq == seq
+				&& stage_checksum (cnt) == header.checksum) {
+			printf ("journal: replaying %"PRIu32" sectors\n", cnt);
+			checkpoint_stage (cnt, NULL);
+		}
+		write_header (0, 0);
+	}
+	enabled = true;
+}
+
+/* Starts an empty journal on a freshly formatted disk. */
+void
+journal_format (void) {
+	if (!setup_region ())
+		return;
+	seq = 0;
+	write_header (0, 0);
+	enabled = true;
+}
+
+/* Returns true if metadata updates go through the journal. */
+bool
+journal_enabled (void) {
+	return enabled;
+}
+
+/* Starts an operation whose metadata updates must be committed
+ * together.  It may add up to JOURNAL_HANDLE_BLOCKS sectors, and
+ * must not call journal_commit().  If the running transaction lacks
+ * room for the operation, waits for the operations under way to end
+ * and then commits it.  A nested call joins the operation already
+ * under way, whose room must cover it. */
+void
+journal_begin (void) {
+	if (!enabled || thread_current ()->journal_depth++ > 0)
+		return;
+	lock_acquire (&journal_lock);
+	for (;;) {
+		if (waiting)
+			cond_wait (&resumed, &journal_lock);
+		else if (running->cnt + (active + 1) * JOURNAL_HANDLE_BLOCKS
+				<= HANDLE_ROOM)
+			break;
+		else if (active > 0)
+			cond_wait (&resumed, &journal_lock);
+		else {
+			lock_release (&journal_lock);
+			journal_commit ();
+			lock_acquire (&journal_lock);
+		}
+	}
+	active++;
+	lock_release (&journal_lock);
+}
+
+/* Ends an operation started by journal_begin(), committing the
+ * running transaction if the operation made it large. */
+void
+journal_end (void) {
+	bool full;
+
+	if (!enabled)
+		return;
+	ASSERT (thread_current ()->journal_depth > 0);
+	if (--thread_current ()->journal_depth > 0)
+		return;
+	lock_acquire (&journal_lock);
+	ASSERT (active > 0);
+	if (--active == 0)
+		cond_signal (&quiet, &journal_lock);
+	cond_broadcast (&resumed, &journal_lock);
+	full = running->cnt >= COMMIT_LIMIT;
+	lock_release (&journal_lock);
+	if (full)
+		journal_commit ();
+}
+
+/* Reads metadata sector SECTOR into BUFFER, which must have room
+ * for DISK_SECTOR_SIZE bytes.  An update not yet checkpointed is
+ * returned in place of the disk's copy. */
+void
+journal_read (disk_sector_t sector, void *buffer) {
+	if (enabled) {
+		struct journal_block *b;
+
+		lock_acquire (&journal_lock);
+		b = txn_find (running, sector);
+		if (b == NULL && committing != NULL)
+			b = txn_find (committing, sector);
+		if (b != NULL && !b->revoked) {
+			memcpy (buffer, b->data, DISK_SECTOR_SIZE);
+			lock_release (&journal_lock);
+			return;
+		}
+		lock_release (&journal_lock);
+	}
+	disk_read (filesys_disk, sector, buffer);
+}
+
+/* Records BUFFER, DISK_SECTOR_SIZE bytes, as the new contents of
+ * metadata sector SECTOR.  It reaches the disk at the next commit. */
+void
+journal_write (disk_sector_t sector, const void *buffer) {
+	struct transaction *t;
+	struct journal_block *b;
+
+	if (!enabled) {
+		disk_write (filesys_disk, sector, buffer);
+		return;
+	}
+
+	lock_acquire (&journal_lock);
+	t = sealing && committer == thread_current () ? committing : running;
+	b = txn_find (t, sector);
+	if (b == NULL) {
+		b = malloc (sizeof *b);
+		if (b == NULL) {
+			/* Out of memory: fall back to writing in place, which
+			 * loses atomicity but not the update. */
+			lock_release (&journal_lock);
+			disk_write (filesys_disk, sector, buffer);
+			return;
+		}
+		b->sector = sector;
+		b->revoked = false;
+		hash_insert (&t->blocks, &b->elem);
+		t->cnt++;
+
+		/* FAT sectors written back outside any operation, such as
+		 * on eviction, are committed promptly too. */
+		if (t == running && t->cnt >= COMMIT_LIMIT && !kicked) {
+			kicked = true;
+			sema_up (&kick);
+		}
+	}
+	memcpy (b->data, buffer, DISK_SECTOR_SIZE);
+	lock_release (&journal_lock);
+}
+
+/* Discards any pending update of SECTOR, whose cluster is being
+ * freed.  Returns once no checkpoint can write SECTOR any more. */
+void
+journal_forget (disk_sector_t sector) {
+	struct journal_block *b;
+	bool wait = false;
+
+	if (!enabled)
+		return;
+
+	lock_acquire (&journal_lock);
+	b = txn_find (running, sector);
+	if (b != NULL) {
+		hash_delete (&running->blocks, &b->elem);
+		running->cnt--;
+		free (b);
+	}
+	if (committing != NULL) {
+		b = txn_find (committing, sector);
+		if (b != NULL && !b->revoked) {
+			b->revoked = true;
+			wait = true;
+		}
+	}
+	lock_release (&journal_lock);
+
+	/* Let a home write of SECTOR already under way finish. */
+	if (wait) {
+		lock_acquire (&checkpoint_lock);
+		lock_release (&checkpoint_lock);
+	}
+}
+
+/* Orders journal blocks by home sector. */
+static int
+block_cmp (const void *a_, const void *b_) {
+	const struct journal_block *a = *(const struct journal_block **) a_;
+	const struct journal_block *b = *(const struct journal_block **) b_;
+	return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+/* Powers off at the commit point of a transaction, for
+ * -journal-crash. */
+static void
+crash_before_checkpoint (void) {
+	printf ("journal: crashing before checkpoint\n");
+	power_off_unflushed ();
+}
+
+/* Writes transaction T to the journal as one commit, then home.
+ * Blocks go in sector order, which puts the FAT, at the front of the
+ * disk, first.  If CRASH, powers off once T is committed instead. */
+static void
+write_transaction (struct transaction *t, bool crash) {
+	struct journal_desc *desc = (struct journal_desc *) stage;
+	struct journal_block **blocks;
+	struct hash_iterator it;
+	size_t n = 0, cnt = 0;
+
+	ASSERT (t->cnt <= JOURNAL_BLOCKS);
+
+	blocks = malloc (t->cnt * sizeof *blocks);
+	if (blocks == NULL)
+		PANIC ("journal: out of memory while committing");
+	hash_first (&it, &t->blocks);
+	while (hash_next (&it))
+		blocks[n++] = hash_entry (hash_cur (&it), struct journal_block, elem);
+	qsort (blocks, n, sizeof *blocks, block_cmp);
+
+	memset (desc, 0, sizeof *desc);
+	desc->magic = JOURNAL_MAGIC;
+	desc->seq = ++seq;
+	lock_acquire (&journal_lock);
+	for (size_t i = 0; i < n; i++)
+		if (!blocks[i]->revoked) {
+			blocks[cnt] = blocks[i];
+			desc->sectors[cnt] = blocks[i]->sector;
+			memcpy (stage + (DESC_SECTORS + cnt) * DISK_SECTOR_SIZE,
+					blocks[i]->data, DISK_SECTOR_SIZE);
+			cnt++;
+		}
+	lock_release (&journal_lock);
+
+	if (cnt > 0) {
+		disk_write_multi (filesys_disk, region + DESC_OFS, DESC_SECTORS + cnt,
+				stage);
+		write_header (cnt, stage_checksum (cnt));
+		if (crash)
+			crash_before_checkpoint ();
+		checkpoint_stage (cnt, blocks);
+		write_header (0, 0);
+	}
+	free (blocks);
+}
+
+/* Commits every metadata update made so far, including the dirty
+ * FAT sectors, and returns once they are on disk.  Waits for running
+ * operations to finish first, so none is split.  Must not be called
+ * between journal_begin() and journal_end(). */
+void
+journal_commit (void) {
+	commit (false);
+}
+
+/* Commits every metadata update made so far, for sync().  Under
+ * -journal-crash, powers off at the commit point instead, so that
+ * the next boot must replay the transaction. */
+void
+journal_sync (void) {
+	commit (journal_crash);
+}
+
+/* Does the work of journal_commit(), powering off at the commit
+ * point if CRASH. */
+static void
+commit (bool crash) {
+	struct transaction *t;
+
+	if (!enabled)
+		return;
+
+	lock_acquire (&commit_lock);
+	lock_acquire (&journal_lock);
+	waiting = true;
+	while (active > 0)
+		cond_wait (&quiet, &journal_lock);
+	t = running;
+	running = t == &txns[0] ? &txns[1] : &txns[0];
+	committing = t;
+	committer = thread_current ();
+	sealing = true;
+	waiting = false;
+	kicked = false;
+	cond_broadcast (&resumed, &journal_lock);
+	lock_release (&journal_lock);
+
+	/* The FAT must match the inodes being committed.  Updates made
+	 * from now on by other threads go to the next transaction. */
+	fat_flush ();
+
+	lock_acquire (&journal_lock);
+	sealing = false;
+	committer = NULL;
+	lock_release (&journal_lock);
+
+	if (t->cnt > 0)
+		write_transaction (t, crash);
+	else if (crash)
+		crash_before_checkpoint ();
+
+	lock_acquire (&journal_lock);
+	committing = NULL;
+	hash_clear (&t->blocks, block_free);
+	t->cnt = 0;
+	lock_release (&journal_lock);
+	lock_release (&commit_lock);
+}
@@ -0,0 +1,238 @@
+/* readahead.c: Sequential readahead for open files.
+ *
+ * Each struct file that is read sequentially gets a staging area that
+ * a background thread fills with the sectors following the current
+ * position, while the reader is busy with the data it already has.
+ * The window starts at RA_MIN_WINDOW sectors and doubles with every
+ * further sequential read, up to RA_MAX_WINDOW.  A read anywhere else
+ * collapses the window to zero and drops the staged data.
+ *
+ * Staged data is tagged with the inode's write generation when it is
+ * read, and ignored if the inode has been written since. */
+
+#include "filesys/readahead.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "devices/disk.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Window bounds, in sectors. */
+#define RA_MIN_WINDOW 4
+#define RA_MAX_WINDOW 32
+
+/* Readahead state of one open file. */
+struct readahead {
+	struct list_elem elem;      /* Element in ra_queue. */
+	struct inode *inode;        /* File's inode. */
+	off_t next;                 /* Where a sequential read would start. */
+	size_t window;              /* Current window in sectors, 0 if off. */
+
+	/* Staging area.  Guarded by ra_lock. */
+	uint8_t *buf;               /* RA_MAX_WINDOW sectors. */
+	off_t buf_ofs;              /* File offset of BUF[0]. */
+	off_t buf_len;              /* Valid bytes in BUF. */
+	unsigned gen;               /* Inode write generation of BUF. */
+	off_t want_ofs;             /* Range the filler will read. */
+	off_t want_len;
+	bool queued;                /* In ra_queue? */
+	bool busy;                  /* Being filled right now? */
+};
+
+static struct list ra_queue;    /* Files waiting to be filled. */
+static struct lock ra_lock;     /* Guards ra_queue and all staging. */
+static struct condition ra_filled; /* Signaled when a fill finishes. */
+static struct semaphore ra_work;   /* Upped once per queued file. */
+
+static void readaheadd (void *aux);
+
+/* Starts the readahead thread. */
+void
+readahead_init (void) {
+	list_init (&ra_queue);
+	lock_init (&ra_lock);
+	cond_init (&ra_filled);
+	sema_init (&ra_work, 0);
+	thread_create ("readaheadd", PRI_DEFAULT, readaheadd, NULL);
+}
+
+/* Copies whatever part of [OFS, OFS + SIZE) FILE has staged, from
+ * OFS onward, into BUFFER.  Waits for a fill in progress that covers
+ * OFS.  Returns the number of bytes copied, possibly 0.
+ *
+ * A user BUFFER is filled from a bounce buffer after ra_lock is
+ * released: faulting in its page may read an executable through
+ * file_read(), which would take ra_lock again. */
+off_t
+readahead_read (struct file *file, void *buffer, off_t size, off_t ofs) {
+	struct readahead *ra = file->ra;
+	uint8_t *bounce = NULL;
+	void *dst = buffer;
+	off_t n = 0;
+
+	if (ra == NULL || size <= 0)
+		return 0;
+
+	if (is_user_vaddr (buffer)) {
+		if (size > RA_MAX_WINDOW * DISK_SECTOR_SIZE)
+			size = RA_MAX_WINDOW * DISK_SECTOR_SIZE;
+		bounce = malloc (size);
+		if (bounce == NULL)
+			return 0;
+		dst = bounce;
+	}
+
+	lock_acquire (&ra_lock);
+	while ((ra->queued || ra->busy)
+			&& ofs >= ra->want_ofs && ofs < ra->want_ofs + ra->want_len)
+		cond_wait (&ra_filled, &ra_lock);
+
+	if (!ra->queued && !ra->busy && ra->gen == inode_write_gen (ra->inode)
+			&& ofs >= ra->buf_ofs && ofs < ra->buf_ofs + ra->buf_len) {
+		n = ra->buf_ofs + ra->buf_len - ofs;
+		if (n > size)
+			n = size;
+		memcpy (dst, ra->buf + (ofs - ra->buf_ofs), n);
+	}
+	lock_release (&ra_lock);
+
+	if (bounce != NULL) {
+		memcpy (buffer, bounce, n);
+		free (bounce);
+	}
+	return n;
+}
+
+/* Records that FILE was just read for SIZE bytes at OFS, adapts the
+ * window, and queues the next window for filling if the reader is
+ * about to run out of staged data. */
+void
+readahead_update (struct file *file, off_t ofs, off_t size) {
+	struct readahead *ra = file->ra;
+	off_t start, len, left;
+
+	if (ra == NULL) {
+		/* A read from the start of the file that the next read
+		 * continues looks sequential.  Waiting for that second read
+		 * keeps most files read only once from getting a staging
+		 * area.  An executable never gets one: its pages are loaded
+		 * on demand by page faults, which must not take ra_lock. */
+		if (size <= 0 || file->deny_write)
+			return;
+		if (ofs == 0 || ofs != file->ra_next) {
+			file->ra_next = ofs == 0 ? size : 0;
+			return;
+		}
+		ra = calloc (1, sizeof *ra);
+		if (ra == NULL)
+			return;
+		ra->buf = malloc (RA_MAX_WINDOW * DISK_SECTOR_SIZE);
+		if (ra->buf == NULL) {
+			free (ra);
+			return;
+		}
+		ra->inode = file_get_inode (file);
+		file->ra = ra;
+	} else if (ofs != ra->next) {
+		/* Random access: stop reading ahead. */
+		lock_acquire (&ra_lock);
+		ra->window = 0;
+		if (!ra->queued && !ra->busy)
+			ra->buf_len = 0;
+		ra->next = ofs + size;
+		lock_release (&ra_lock);
+		return;
+	}
+
+	ra->next = ofs + size;
+	ra->window = ra->window == 0 ? RA_MIN_WINDOW : ra->window * 2;
+	if (ra->window > RA_MAX_WINDOW)
+		ra->window = RA_MAX_WINDOW;
+
+	lock_acquire (&ra_lock);
+	if (ra->queued || ra->busy) {
+		lock_release (&ra_lock);
+		return;
+	}
+	left = ra->buf_ofs + ra->buf_len - ra->next;
+	if (left >= (off_t) ra->window * DISK_SECTOR_SIZE / 2) {
+		lock_release (&ra_lock);
+		return;
+	}
+	start = ROUND_DOWN (ra->next, DISK_SECTOR_SIZE);
+	len = inode_length (ra->inode) - start;
+	if (len > (off_t) ra->window * DISK_SECTOR_SIZE)
+		len = ra->window * DISK_SECTOR_SIZE;
+	if (len <= 0) {
+		lock_release (&ra_lock);
+		return;
+	}
+	ra->want_ofs = start;
+	ra->want_len = len;
+	ra->buf_len = 0;
+	ra->queued = true;
+	list_push_back (&ra_queue, &ra->elem);
+	lock_release (&ra_lock);
+	sema_up (&ra_work);
+}
+
+/* Frees FILE's readahead state, after any fill in progress. */
+void
+readahead_release (struct file *file) {
+	struct readahead *ra = file->ra;
+
+	if (ra == NULL)
+		return;
+
+	lock_acquire (&ra_lock);
+	if (ra->queued) {
+		list_remove (&ra->elem);
+		ra->queued = false;
+	}
+	while (ra->busy)
+		cond_wait (&ra_filled, &ra_lock);
+	lock_release (&ra_lock);
+
+	file->ra = NULL;
+	free (ra->buf);
+	free (ra);
+}
+
+/* Readahead thread: fills the staging area of each queued file. */
+static void
+readaheadd (void *aux UNUSED) {
+	for (;;) {
+		struct readahead *ra;
+		unsigned gen;
+		off_t n;
+
+		sema_down (&ra_work);
+		lock_acquire (&ra_lock);
+		if (list_empty (&ra_queue)) {
+			/* Its file was closed before we got to it. */
+			lock_release (&ra_lock);
+			continue;
+		}
+		ra = list_entry (list_pop_front (&ra_queue), struct readahead, elem);
+		ra->queued = false;
+		ra->busy = true;
+		lock_release (&ra_lock);
+
+		gen = inode_write_gen (ra->inode);
+		n = inode_read_at (ra->inode, ra->buf, ra->want_len, ra->want_ofs);
+
+		lock_acquire (&ra_lock);
+		ra->buf_ofs = ra->want_ofs;
+		ra->buf_len = n;
+		ra->gen = gen;
+		ra->busy = false;
+		cond_broadcast (&ra_filled, &ra_lock);
+		lock_release (&ra_lock);
+	}
+}
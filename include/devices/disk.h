@@ -2,6 +2,9 @@
 #define DEVICES_DISK_H
 
 #include <inttypes.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "threads/vaddr.h"
 #include "threads/vaddr.h"
@@ -9,6 +12,10 @@
 /* Size of a disk sector in bytes. */
 #define DISK_SECTOR_SIZE 512
 
+/* Most sectors disk_read_multi() and disk_write_multi() move in one
+ * command. */
+#define DISK_MAX_MULTI 256
+
 /* Index of a disk sector within a disk.
  * Good enough for disks up to 2 TB. */
 typedef uint32_t disk_sector_t;
@@ -17,13 +24,50 @@ typedef uint32_t disk_sector_t;
  * printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+/* I/O priority classes, highest first.  The request queue serves
+ * the highest class that has requests queued, except that a request
+ * of any class waiting past its class's deadline goes first. */
+enum disk_ioprio {
+	DISK_IOPRIO_RT,             /* Real-time: interactive threads. */
+	DISK_IOPRIO_BE,             /* Best-effort: the default. */
+	DISK_IOPRIO_IDLE,           /* Idle: background work. */
+	DISK_IOPRIO_CNT
+};
+
+/* An asynchronous transfer, queued by disk_submit(). */
+struct disk_request {
+	struct disk *disk;          /* Disk to transfer with. */
+	disk_sector_t sector;       /* First sector. */
+	size_t cnt;                 /* Number of sectors. */
+	void *buffer;               /* CNT * DISK_SECTOR_SIZE bytes. */
+	bool write;                 /* Write BUFFER to disk, else read into it. */
+	void (*done) (struct disk_request *);  /* Called when complete. */
+	void *aux;                  /* For DONE's use. */
+
+	/* Owned by the disk driver. */
+	struct list_elem elem;      /* Element in the channel queue. */
+	enum disk_ioprio prio;      /* Class of the submitting thread. */
+	int64_t deadline;           /* Serve by this timer tick. */
+	uint64_t submit_time;       /* Microseconds since boot at submit. */
+	int tid;                    /* Submitting thread. */
+};
+
+extern bool disk_detailed_stats;
+
 void disk_init (void);
 void disk_print_stats (void);
+void disk_dump_trace (void);
 
 struct disk *disk_get (int chan_no, int dev_no);
+struct disk *disk_stripe (struct disk *members[], size_t cnt);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
+void disk_read_multi (struct disk *, disk_sector_t, size_t cnt, void *);
+void disk_write_multi (struct disk *, disk_sector_t, size_t cnt,
+		const void *);
+void disk_submit (struct disk_request *);
+enum disk_ioprio disk_ioprio_current (void);
 
 void 	register_disk_inspect_intr ();
 
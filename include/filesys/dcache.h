@@ -0,0 +1,23 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Result of a directory entry cache lookup. */
+enum dcache_result {
+	DCACHE_MISS,                /* Nothing cached for (parent, name). */
+	DCACHE_NEGATIVE,            /* Cached: NAME does not exist in parent. */
+	DCACHE_POSITIVE             /* Cached: NAME maps to a child inode. */
+};
+
+void dcache_init (void);
+enum dcache_result dcache_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp, bool *is_dirp);
+void dcache_insert (disk_sector_t parent, const char *name,
+		disk_sector_t sector, bool is_dir);
+void dcache_insert_negative (disk_sector_t parent, const char *name);
+void dcache_invalidate (disk_sector_t parent, const char *name);
+void dcache_purge (disk_sector_t parent);
+
+#endif /* filesys/dcache.h */
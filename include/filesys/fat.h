@@ -4,6 +4,7 @@
 #include "devices/disk.h"
 #include "filesys/file.h"
 #include <inttypes.h>
+#include <statfs.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -13,8 +14,18 @@ typedef uint32_t cluster_t;  /* Index of a cluster within FAT. */
 #define FAT_MAGIC 0xEB3C9000 /* MAGIC string to identify FAT disk */
 #define EOChain 0x0FFFFFFF   /* End of cluster chain */
 
+/* Flag kept in the reserved high bits of a FAT entry.  A cluster
+ * marked unwritten is allocated in its chain but has never been
+ * written, so its contents read as zeros without touching the disk. */
+#define FAT_UNWRITTEN 0x80000000
+#define FAT_FLAGS FAT_UNWRITTEN
+
+/* Number of FAT sectors kept in memory at once. */
+#define FAT_CACHE_SIZE 64
+
 /* Sectors of FAT information. */
-#define SECTORS_PER_CLUSTER 1 /* Number of sectors per cluster */
+#define SECTORS_PER_CLUSTER 1 /* Default number of sectors per cluster */
+#define MAX_SECTORS_PER_CLUSTER 64 /* Largest cluster "-f=N" accepts */
 #define FAT_BOOT_SECTOR 0     /* FAT boot sector. */
 #define ROOT_DIR_CLUSTER 1    /* Cluster for the root directory */
 
@@ -22,18 +33,37 @@ void fat_init (void);
 void fat_open (void);
 void fat_close (void);
 void fat_create (void);
-void fat_close (void);
+void fat_flush (void);
+void fat_flush_sector (unsigned idx);
+unsigned fat_sector_of (cluster_t clst);
+bool fat_journal_region (disk_sector_t *start, size_t *cnt);
+bool fat_inodes_unknown (void);
+void fat_count_inode (int delta);
+void fat_statfs (struct statfs *);
+
+/* Write FAT changes through before returning ("-fat-ordered"). */
+extern bool fat_ordered_writes;
+
+/* Cluster size, in sectors, for a newly formatted disk ("-f=N"). */
+extern unsigned int fat_format_cluster_size;
 
 cluster_t fat_create_chain (
     cluster_t clst /* Cluster # to stretch, 0: Create a new chain */
 );
+cluster_t fat_create_run (
+    cluster_t clst, /* Cluster # to stretch, 0: Create a new chain */
+    size_t cnt      /* Number of contiguous clusters to add */
+);
 void fat_remove_chain (
     cluster_t clst, /* Cluster # to be removed */
     cluster_t pclst /* Previous cluster of clst, 0: clst is the start of chain */
 );
 cluster_t fat_get (cluster_t clst);
 void fat_put (cluster_t clst, cluster_t val);
+bool fat_is_unwritten (cluster_t clst);
+void fat_set_unwritten (cluster_t clst, bool unwritten);
 disk_sector_t cluster_to_sector (cluster_t clst);
+unsigned int fat_sectors_per_cluster (void);
 
 /* project 4*/
 cluster_t sector_to_cluster (disk_sector_t sect);
@@ -3,9 +3,12 @@
 
 #include "filesys/off_t.h"
 #include "stdbool.h"
+#include <stddef.h>
 
 
 struct inode;
+struct readahead;
+struct iovec;
 
 /* An open file. */
 struct file {
@@ -13,6 +16,8 @@ struct file {
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
 	int dup_count;				/* Extra : Dup2 */
+	struct readahead *ra;		/* Readahead state, if reading sequentially. */
+	off_t ra_next;				/* End of a first read from offset 0, else 0. */
 };
 
 /* Opening and closing files. */
@@ -27,6 +32,12 @@ off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+off_t file_readv (struct file *, const struct iovec *, int cnt);
+off_t file_writev (struct file *, const struct iovec *, int cnt);
+off_t file_copy_range (struct file *in, struct file *out, off_t size);
+void file_sync (struct file *);
+bool file_allocate (struct file *, off_t offset, off_t len);
+bool file_defrag (struct file *, size_t *before, size_t *after);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
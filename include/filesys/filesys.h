@@ -12,15 +12,15 @@
 /* Disk used for file system. */
 extern struct disk *filesys_disk;
 
+/* Stripe the file system over hd0:1 and hd1:0 ("-stripe"). */
+extern bool filesys_striped;
+
 void filesys_init (bool format);
 void filesys_done (void);
+void filesys_sync (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
-bool filesys_change_dir(char *path);
-bool filesys_create_dir(char *name);
-struct dir *parse_path(char *name, char *file_name);
-static void add_dot(disk_sector_t cur, disk_sector_t parent);
 
 /*project 4*/
 struct dir* parse_path(char *path_name, char *file_name);
@@ -13,19 +13,59 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* project 4 */
 #include "include/filesys/fat.h"
 
 
 struct bitmap;
+struct iovec;
 
+/* Number of extents stored in the inode sector itself, and in the
+ * single indirect extent block. */
+#define INODE_DIRECT_EXTENTS 60
+#define INODE_INDIRECT_EXTENTS (DISK_SECTOR_SIZE / sizeof (struct inode_extent))
+#define INODE_MAX_EXTENTS (INODE_DIRECT_EXTENTS + INODE_INDIRECT_EXTENTS)
+
+/* A run of physically contiguous clusters holding consecutive file
+ * data. */
+struct inode_extent {
+	uint32_t start;                     /* First cluster of the run. */
+	uint32_t count;                     /* Number of clusters. */
+};
+
+/* Number of distinct FAT sectors an inode remembers changing before
+ * it gives up and has inode_sync() flush the whole FAT. */
+#define INODE_FAT_TRACK 8
+
+/* Largest file whose data fits inside the inode sector. */
+#define INODE_INLINE_MAX (INODE_DIRECT_EXTENTS * sizeof (struct inode_extent))
+
+/* On-disk inode.
+ * Data is addressed through EXTENTS, in file order.  An inode with
+ * EXTENT_CNT 0 but a nonzero START is addressed by walking its FAT
+ * chain instead: either it predates extents, or it became too
+ * fragmented to describe.  The FAT chain is kept linked either way,
+ * since it also records which clusters are allocated.
+ *
+ * Files of up to INODE_INLINE_MAX bytes keep their data in place of
+ * the extents (IS_INLINE) and own no clusters at all, so reading one
+ * costs only the inode sector.  Growing past that moves the data out
+ * to a cluster. */
 struct inode_disk {
 	disk_sector_t start;                /* First data sector. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
 	bool is_dir; 					/*파일, 디렉터리 구분*/
-	uint32_t unused[124];               /* Not used. */
+	bool is_inline;                     /* Data stored in INLINE_DATA? */
+	uint32_t extent_cnt;                /* Extents in use, in total. */
+	disk_sector_t indirect;             /* Indirect extent block, or 0. */
+	union {
+		struct inode_extent extents[INODE_DIRECT_EXTENTS];
+		uint8_t inline_data[INODE_INLINE_MAX];
+	};
+	uint32_t unused[2];                 /* Not used. */
 };
 
 
@@ -34,8 +74,22 @@ struct inode {
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
+	bool dirty;                         /* DATA differs from the disk copy? */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct rwlock rwlock;               /* Guards data and length. */
+	struct lock dir_lock;               /* Serializes directory updates. */
 	struct inode_disk data;             /* Inode content. */
+	struct inode_extent *ind_extents;   /* Indirect extents, if any. */
+	bool ind_dirty;                     /* IND_EXTENTS need writing? */
+	unsigned write_gen;                 /* Bumped by every data write. */
+	uint8_t *wbuf;                      /* Write-combining sector buffer. */
+	disk_sector_t wbuf_sector;          /* Sector WBUF holds. */
+	bool wbuf_valid;                    /* WBUF holds unwritten data? */
+	unsigned fat_dirty[INODE_FAT_TRACK]; /* FAT sectors changed for us. */
+	int fat_dirty_cnt;                  /* Entries used, -1 if too many. */
+	bool loading;                       /* Still being read by inode_open()? */
+	bool closing;                       /* Being written back on last close? */
+	struct list_elem flush_elem;        /* Element in inode_flush_all() list. */
 };
 
 void inode_init (void);
@@ -47,9 +101,19 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_read_iov (struct inode *, const struct iovec *, int cnt,
+		off_t offset);
+off_t inode_write_iov (struct inode *, const struct iovec *, int cnt,
+		off_t offset);
+bool inode_allocate (struct inode *, off_t offset, off_t len);
+bool inode_defrag (struct inode *, size_t *before, size_t *after);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+unsigned inode_write_gen (const struct inode *);
+void inode_flush (struct inode *);
+void inode_flush_all (void);
+void inode_sync (struct inode *);
 
 
 /*project 4*/
@@ -0,0 +1,33 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Size of the journal region a newly formatted disk reserves right
+ * after the FAT: a header, a two-sector descriptor and the blocks of
+ * one transaction. */
+#define JOURNAL_SECTORS 256
+
+/* Most metadata sectors one operation between journal_begin() and
+ * journal_end() may add to a transaction. */
+#define JOURNAL_HANDLE_BLOCKS 64
+
+void journal_init (void);
+void journal_open (void);
+void journal_format (void);
+bool journal_enabled (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_read (disk_sector_t, void *);
+void journal_write (disk_sector_t, const void *);
+void journal_forget (disk_sector_t);
+void journal_commit (void);
+void journal_sync (void);
+
+/* Power off at the commit point of sync(), before any home write, as
+ * a crash there would ("-journal-crash"). */
+extern bool journal_crash;
+
+#endif /* filesys/journal.h */
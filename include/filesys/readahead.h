@@ -0,0 +1,13 @@
+#ifndef FILESYS_READAHEAD_H
+#define FILESYS_READAHEAD_H
+
+#include "filesys/off_t.h"
+
+struct file;
+
+void readahead_init (void);
+off_t readahead_read (struct file *, void *buffer, off_t size, off_t ofs);
+void readahead_update (struct file *, off_t ofs, off_t size);
+void readahead_release (struct file *);
+
+#endif /* filesys/readahead.h */
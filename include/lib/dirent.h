@@ -0,0 +1,16 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+/* One directory entry returned by getdents(). */
+struct dirent {
+	unsigned int d_ino;         /* Sector of the entry's inode.  Not
+	                               the cluster inumber() returns. */
+	unsigned char d_type;       /* DT_REG or DT_DIR. */
+	char d_name[15];            /* Null-terminated name, up to 14 chars. */
+};
+
+/* Values of d_type. */
+#define DT_REG 1                /* Regular file. */
+#define DT_DIR 2                /* Directory. */
+
+#endif /* lib/dirent.h */
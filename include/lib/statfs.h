@@ -0,0 +1,12 @@
+#ifndef __LIB_STATFS_H
+#define __LIB_STATFS_H
+
+/* File system size and usage, as returned by statfs(). */
+struct statfs {
+	unsigned f_bsize;           /* Bytes per cluster. */
+	unsigned f_blocks;          /* Data clusters in the file system. */
+	unsigned f_bfree;           /* Data clusters free. */
+	unsigned f_inodes;          /* Inodes of files and directories. */
+};
+
+#endif /* lib/statfs.h */
@@ -36,6 +36,24 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Positioned and vectored I/O. */
+	SYS_PREAD,                  /* Read from a file at a given offset. */
+	SYS_PWRITE,                 /* Write to a file at a given offset. */
+	SYS_READV,                  /* Read from a file into several buffers. */
+	SYS_WRITEV,                 /* Write to a file from several buffers. */
+	SYS_COPY_FILE_RANGE,        /* Copy data between files in the kernel. */
+
+	/* Durability. */
+	SYS_FSYNC,                  /* Flush a file's data and metadata. */
+	SYS_FDATASYNC,              /* Flush what is needed to read a file back. */
+	SYS_SYNC,                   /* Flush the whole file system. */
+	SYS_FALLOCATE,              /* Reserve disk space for a file. */
+	SYS_DEFRAG,                 /* Move a file into contiguous clusters. */
+
+	/* Directories. */
+	SYS_GETDENTS,               /* Read many directory entries at once. */
+	SYS_STATFS,                 /* Report file system size and usage. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,15 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+#include <stddef.h>
+
+/* One buffer of a vectored read or write. */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Size of the buffer in bytes. */
+};
+
+/* Maximum number of buffers in a single readv() or writev(). */
+#define IOV_MAX 1024
+
+#endif /* lib/uio.h */
@@ -3,7 +3,10 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <dirent.h>
 #include <stddef.h>
+#include <statfs.h>
+#include <uio.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -38,6 +41,18 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+
+int fsync (int fd);
+int fdatasync (int fd);
+void sync (void);
+int fallocate (int fd, off_t offset, off_t len);
+int defrag (int fd);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
@@ -46,6 +61,8 @@ void munmap (void *addr);
 bool chdir (const char *dir);
 bool mkdir (const char *dir);
 bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
+int getdents (int fd, struct dirent *buf, unsigned size);
+int statfs (struct statfs *buf);
 bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
@@ -40,6 +40,25 @@ void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 bool cmp_sem_priority(struct list_elem *e1, struct list_elem *e2);
 
+/* Readers-writer lock.
+   Any number of readers may hold it at once, or a single writer.
+   Waiting writers block new readers, so writers do not starve. */
+struct rwlock {
+	struct lock lock;           /* Protects the fields below. */
+	struct condition readers_ok;    /* Signaled when readers may enter. */
+	struct condition writers_ok;    /* Signaled when a writer may enter. */
+	int readers;                /* Number of readers holding the lock. */
+	int waiting_writers;        /* Number of writers waiting. */
+	struct thread *writer;      /* Writer holding the lock, if any. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
@@ -139,6 +139,7 @@ struct thread {
 	/*project 4*/
 
 	struct dir *cur_dir;
+	int journal_depth;                  /* Nesting of journal_begin(). */
 
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
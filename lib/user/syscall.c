@@ -54,7 +54,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -145,6 +145,56 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+copy_file_range (int fd_in, int fd_out, unsigned length) {
+	return syscall3 (SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
+int
+fsync (int fd) {
+	return syscall1 (SYS_FSYNC, fd);
+}
+
+int
+fdatasync (int fd) {
+	return syscall1 (SYS_FDATASYNC, fd);
+}
+
+void
+sync (void) {
+	syscall0 (SYS_SYNC);
+}
+
+int
+fallocate (int fd, off_t offset, off_t len) {
+	return syscall3 (SYS_FALLOCATE, fd, offset, len);
+}
+
+int
+defrag (int fd) {
+	return syscall1 (SYS_DEFRAG, fd);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
@@ -170,6 +220,16 @@ readdir (int fd, char name[READDIR_MAX_LEN + 1]) {
 	return syscall2 (SYS_READDIR, fd, name);
 }
 
+int
+getdents (int fd, struct dirent *buf, unsigned size) {
+	return syscall3 (SYS_GETDENTS, fd, buf, size);
+}
+
+int
+statfs (struct statfs *buf) {
+	return syscall1 (SYS_STATFS, buf);
+}
+
 bool
 isdir (int fd) {
 	return syscall1 (SYS_ISDIR, fd);
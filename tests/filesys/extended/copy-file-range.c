@@ -0,0 +1,56 @@
+/* Copies most of one file into another with copy_file_range and
+   checks both positions and the copy, then checks that copies
+   within one file whose ranges overlap are refused. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 9000
+#define SKIP 1000
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  int in, out, again;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("src", 0), "create \"src\"");
+  CHECK ((in = open ("src")) > 1, "open \"src\"");
+  CHECK (write (in, buf, sizeof buf) == FILE_SIZE, "write \"src\"");
+  CHECK (create ("dst", 0), "create \"dst\"");
+  CHECK ((out = open ("dst")) > 1, "open \"dst\"");
+
+  msg ("seek \"src\" to %d", SKIP);
+  seek (in, SKIP);
+  CHECK (copy_file_range (in, out, FILE_SIZE) == FILE_SIZE - SKIP,
+         "copy rest of \"src\" to \"dst\"");
+  CHECK (tell (in) == FILE_SIZE, "\"src\" position at its end");
+  CHECK (tell (out) == FILE_SIZE - SKIP, "\"dst\" position at its end");
+  CHECK (copy_file_range (in, out, 100) == 0, "copy at end of \"src\"");
+  CHECK (copy_file_range (in, 0, 100) == -1, "copy to stdin");
+
+  msg ("seek \"src\" to 0");
+  seek (in, 0);
+  CHECK (copy_file_range (in, in, 100) == -1, "copy \"src\" onto itself");
+  CHECK ((again = open ("src")) > 1, "open \"src\" again");
+  msg ("seek second \"src\" to 100");
+  seek (again, 100);
+  CHECK (copy_file_range (in, again, 1000) == -1,
+         "copy overlapping range within \"src\"");
+  CHECK (tell (in) == 0 && tell (again) == 100,
+         "positions unchanged");
+  msg ("close second \"src\"");
+  close (again);
+
+  msg ("close \"src\"");
+  close (in);
+  msg ("close \"dst\"");
+  close (out);
+  check_file ("src", buf, FILE_SIZE);
+  check_file ("dst", buf + SKIP, FILE_SIZE - SKIP);
+}
@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) create "src"
+(copy-file-range) open "src"
+(copy-file-range) write "src"
+(copy-file-range) create "dst"
+(copy-file-range) open "dst"
+(copy-file-range) seek "src" to 1000
+(copy-file-range) copy rest of "src" to "dst"
+(copy-file-range) "src" position at its end
+(copy-file-range) "dst" position at its end
+(copy-file-range) copy at end of "src"
+(copy-file-range) copy to stdin
+(copy-file-range) seek "src" to 0
+(copy-file-range) copy "src" onto itself
+(copy-file-range) open "src" again
+(copy-file-range) seek second "src" to 100
+(copy-file-range) copy overlapping range within "src"
+(copy-file-range) positions unchanged
+(copy-file-range) close second "src"
+(copy-file-range) close "src"
+(copy-file-range) close "dst"
+(copy-file-range) open "src" for verification
+(copy-file-range) verified contents of "src"
+(copy-file-range) close "src"
+(copy-file-range) open "dst" for verification
+(copy-file-range) verified contents of "dst"
+(copy-file-range) close "dst"
+(copy-file-range) end
+EOF
+pass;
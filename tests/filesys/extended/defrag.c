@@ -0,0 +1,53 @@
+/* Grows two files in alternation so that their clusters interleave,
+   then defragments one and checks that it ends up in one piece with
+   both files' contents intact. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK 512
+#define FILE_SIZE (40 * CHUNK)
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+void
+test_main (void)
+{
+  int fd_a, fd_b;
+  int frags;
+  size_t ofs;
+
+  random_init (0);
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd_a = open ("a")) > 1, "open \"a\"");
+  CHECK ((fd_b = open ("b")) > 1, "open \"b\"");
+
+  msg ("write \"a\" and \"b\" alternately");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK)
+    {
+      if (write (fd_a, buf_a + ofs, CHUNK) != CHUNK)
+        fail ("write %d bytes at offset %zu in \"a\" failed", CHUNK, ofs);
+      if (write (fd_b, buf_b + ofs, CHUNK) != CHUNK)
+        fail ("write %d bytes at offset %zu in \"b\" failed", CHUNK, ofs);
+    }
+
+  frags = defrag (fd_a);
+  if (frags <= 1)
+    fail ("defrag \"a\" found %d fragments, expected several", frags);
+  msg ("defrag \"a\"");
+  CHECK (defrag (fd_a) == 1, "\"a\" is now in one piece");
+  CHECK (defrag (1) == -1, "defrag stdout");
+
+  msg ("close \"a\"");
+  close (fd_a);
+  msg ("close \"b\"");
+  close (fd_b);
+  check_file ("a", buf_a, sizeof buf_a);
+  check_file ("b", buf_b, sizeof buf_b);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(defrag) begin
+(defrag) create "a"
+(defrag) create "b"
+(defrag) open "a"
+(defrag) open "b"
+(defrag) write "a" and "b" alternately
+(defrag) defrag "a"
+(defrag) "a" is now in one piece
+(defrag) defrag stdout
+(defrag) close "a"
+(defrag) close "b"
+(defrag) open "a" for verification
+(defrag) verified contents of "a"
+(defrag) close "a"
+(defrag) open "b" for verification
+(defrag) verified contents of "b"
+(defrag) close "b"
+(defrag) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($data) = random_bytes (100);
+check_archive ({"testfile" => ["\0" x 5000 . $data . "\0" x (20000 - 5100)]});
+pass;
@@ -0,0 +1,51 @@
+/* Reserves space for a file with fallocate, checks that it reads
+   as zeros and takes clusters, then writes into the middle and
+   reserves again over what is already there. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 20000
+#define DATA_OFS 5000
+#define DATA_SIZE 100
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  struct statfs before, after;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (statfs (&before) == 0, "statfs");
+  CHECK (fallocate (fd, 0, FILE_SIZE) == 0, "fallocate %d bytes", FILE_SIZE);
+  CHECK (statfs (&after) == 0, "statfs");
+  if (before.f_bfree - after.f_bfree < FILE_SIZE / after.f_bsize)
+    fail ("only %u clusters reserved", before.f_bfree - after.f_bfree);
+  msg ("clusters reserved");
+  CHECK (filesize (fd) == FILE_SIZE, "file size is %d", FILE_SIZE);
+  CHECK (tell (fd) == 0, "position still 0");
+  check_file_handle (fd, file_name, buf, sizeof buf);
+
+  random_init (0);
+  random_bytes (buf + DATA_OFS, DATA_SIZE);
+  msg ("seek \"%s\" to %d", file_name, DATA_OFS);
+  seek (fd, DATA_OFS);
+  CHECK (write (fd, buf + DATA_OFS, DATA_SIZE) == DATA_SIZE,
+         "write %d bytes", DATA_SIZE);
+  CHECK (fallocate (fd, 0, FILE_SIZE / 2) == 0,
+         "fallocate within the file");
+  CHECK (filesize (fd) == FILE_SIZE, "file size is still %d", FILE_SIZE);
+
+  CHECK (fallocate (fd, -1, 10) == -1, "fallocate at negative offset");
+  CHECK (fallocate (fd, 0, 0) == -1, "fallocate 0 bytes");
+  CHECK (fallocate (1, 0, 10) == -1, "fallocate stdout");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fallocate) begin
+(fallocate) create "testfile"
+(fallocate) open "testfile"
+(fallocate) statfs
+(fallocate) fallocate 20000 bytes
+(fallocate) statfs
+(fallocate) clusters reserved
+(fallocate) file size is 20000
+(fallocate) position still 0
+(fallocate) verified contents of "testfile"
+(fallocate) seek "testfile" to 5000
+(fallocate) write 100 bytes
+(fallocate) fallocate within the file
+(fallocate) file size is still 20000
+(fallocate) fallocate at negative offset
+(fallocate) fallocate 0 bytes
+(fallocate) fallocate stdout
+(fallocate) close "testfile"
+(fallocate) open "testfile" for verification
+(fallocate) verified contents of "testfile"
+(fallocate) close "testfile"
+(fallocate) end
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Flushes files with fsync, fdatasync and sync and checks that
+   the data is then read back, now and after a reboot. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 4321
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+void
+test_main (void)
+{
+  int fd_a, fd_b;
+
+  random_init (0);
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK ((fd_a = open ("a")) > 1, "open \"a\"");
+  CHECK (write (fd_a, buf_a, sizeof buf_a) == FILE_SIZE, "write \"a\"");
+  CHECK (fsync (fd_a) == 0, "fsync \"a\"");
+  CHECK (fdatasync (fd_a) == 0, "fdatasync \"a\"");
+
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd_b = open ("b")) > 1, "open \"b\"");
+  CHECK (write (fd_b, buf_b, sizeof buf_b) == FILE_SIZE, "write \"b\"");
+  msg ("sync");
+  sync ();
+
+  CHECK (fsync (1) == -1, "fsync stdout");
+  CHECK (fsync (100) == -1, "fsync bad fd");
+
+  msg ("close \"a\"");
+  close (fd_a);
+  msg ("close \"b\"");
+  close (fd_b);
+  check_file ("a", buf_a, sizeof buf_a);
+  check_file ("b", buf_b, sizeof buf_b);
+}
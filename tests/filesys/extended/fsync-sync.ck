@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync-sync) begin
+(fsync-sync) create "a"
+(fsync-sync) open "a"
+(fsync-sync) write "a"
+(fsync-sync) fsync "a"
+(fsync-sync) fdatasync "a"
+(fsync-sync) create "b"
+(fsync-sync) open "b"
+(fsync-sync) write "b"
+(fsync-sync) sync
+(fsync-sync) fsync stdout
+(fsync-sync) fsync bad fd
+(fsync-sync) close "a"
+(fsync-sync) close "b"
+(fsync-sync) open "a" for verification
+(fsync-sync) verified contents of "a"
+(fsync-sync) close "a"
+(fsync-sync) open "b" for verification
+(fsync-sync) verified contents of "b"
+(fsync-sync) close "b"
+(fsync-sync) end
+EOF
+pass;
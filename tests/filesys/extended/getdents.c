@@ -0,0 +1,76 @@
+/* Lists a directory with getdents, all at once and one entry at a
+   time, and checks the names and types returned. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const char *names[] = { "a", "b", "c" };
+static const unsigned char types[] = { DT_REG, DT_REG, DT_DIR };
+
+/* Checks that the CNT entries of ENTS name each of NAMES once. */
+static void
+check_entries (const struct dirent *ents, int cnt)
+{
+  bool seen[3] = { false, false, false };
+  int i, j;
+
+  if (cnt != 3)
+    fail ("getdents returned %d entries, expected 3", cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      for (j = 0; j < 3; j++)
+        if (!strcmp (ents[i].d_name, names[j]))
+          break;
+      if (j == 3)
+        fail ("unexpected entry \"%s\"", ents[i].d_name);
+      if (seen[j])
+        fail ("entry \"%s\" returned twice", ents[i].d_name);
+      if (ents[i].d_type != types[j])
+        fail ("entry \"%s\" has type %d, expected %d",
+              ents[i].d_name, ents[i].d_type, types[j]);
+      seen[j] = true;
+    }
+}
+
+void
+test_main (void)
+{
+  struct dirent ents[8];
+  int fd, n, cnt;
+
+  CHECK (mkdir ("dir"), "mkdir \"dir\"");
+  CHECK (create ("dir/a", 0), "create \"dir/a\"");
+  CHECK (create ("dir/b", 0), "create \"dir/b\"");
+  CHECK (mkdir ("dir/c"), "mkdir \"dir/c\"");
+
+  CHECK ((fd = open ("dir")) > 1, "open \"dir\"");
+  n = getdents (fd, ents, sizeof ents);
+  if (n < 0 || n % sizeof *ents != 0)
+    fail ("getdents returned %d", n);
+  check_entries (ents, n / sizeof *ents);
+  msg ("getdents \"dir\" at once");
+  CHECK (getdents (fd, ents, sizeof ents) == 0, "getdents at end");
+  msg ("close \"dir\"");
+  close (fd);
+
+  CHECK ((fd = open ("dir")) > 1, "open \"dir\"");
+  for (cnt = 0; cnt < 8; cnt++)
+    {
+      n = getdents (fd, ents + cnt, sizeof *ents);
+      if (n == 0)
+        break;
+      if (n != (int) sizeof *ents)
+        fail ("getdents of one entry returned %d", n);
+    }
+  check_entries (ents, cnt);
+  msg ("getdents \"dir\" one entry at a time");
+  msg ("close \"dir\"");
+  close (fd);
+
+  CHECK ((fd = open ("dir/a")) > 1, "open \"dir/a\"");
+  CHECK (getdents (fd, ents, sizeof ents) == -1, "getdents on a file");
+  msg ("close \"dir/a\"");
+  close (fd);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(getdents) begin
+(getdents) mkdir "dir"
+(getdents) create "dir/a"
+(getdents) create "dir/b"
+(getdents) mkdir "dir/c"
+(getdents) open "dir"
+(getdents) getdents "dir" at once
+(getdents) getdents at end
+(getdents) close "dir"
+(getdents) open "dir"
+(getdents) getdents "dir" one entry at a time
+(getdents) close "dir"
+(getdents) open "dir/a"
+(getdents) getdents on a file
+(getdents) close "dir/a"
+(getdents) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Checks that a small file keeps its data in its inode, taking no
+   clusters, and that it moves to clusters once it outgrows the
+   inode, keeping its contents. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SMALL_SIZE 100
+#define FILE_SIZE 2000
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  struct statfs s1, s2, s3;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (statfs (&s1) == 0, "statfs");
+  CHECK (write (fd, buf, SMALL_SIZE) == SMALL_SIZE,
+         "write %d bytes", SMALL_SIZE);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (statfs (&s2) == 0, "statfs");
+  CHECK (s2.f_bfree == s1.f_bfree, "small file takes no clusters");
+  check_file (file_name, buf, SMALL_SIZE);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("seek \"%s\" to %d", file_name, SMALL_SIZE);
+  seek (fd, SMALL_SIZE);
+  CHECK (write (fd, buf + SMALL_SIZE, FILE_SIZE - SMALL_SIZE)
+         == FILE_SIZE - SMALL_SIZE, "grow to %d bytes", FILE_SIZE);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (statfs (&s3) == 0, "statfs");
+  CHECK (s3.f_bfree < s2.f_bfree, "grown file takes clusters");
+  check_file (file_name, buf, FILE_SIZE);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(inline-data) begin
+(inline-data) create "testfile"
+(inline-data) open "testfile"
+(inline-data) statfs
+(inline-data) write 100 bytes
+(inline-data) close "testfile"
+(inline-data) statfs
+(inline-data) small file takes no clusters
+(inline-data) open "testfile" for verification
+(inline-data) verified contents of "testfile"
+(inline-data) close "testfile"
+(inline-data) open "testfile"
+(inline-data) seek "testfile" to 100
+(inline-data) grow to 2000 bytes
+(inline-data) close "testfile"
+(inline-data) statfs
+(inline-data) grown file takes clusters
+(inline-data) open "testfile" for verification
+(inline-data) verified contents of "testfile"
+(inline-data) close "testfile"
+(inline-data) end
+EOF
+pass;
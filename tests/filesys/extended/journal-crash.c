@@ -0,0 +1,32 @@
+/* Writes a file and calls sync under -journal-crash, which powers
+   the machine off at the journal's commit point, before any of the
+   metadata reaches its home.  The persistence check then finds the
+   file only if the next boot replays the journal. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 6144
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK (create ("d/a", 0), "create \"d/a\"");
+  CHECK ((fd = open ("d/a")) > 1, "open \"d/a\"");
+  CHECK (write (fd, buf, sizeof buf) == FILE_SIZE, "write \"d/a\"");
+  msg ("close \"d/a\"");
+  close (fd);
+
+  msg ("sync");
+  sync ();
+  fail ("sync returned");
+}
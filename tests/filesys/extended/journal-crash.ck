@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "missing 'sync' message\n"
+  if !grep ($_ eq '(journal-crash) sync', @output);
+fail "kernel did not stop at the commit point\n"
+  if !grep ($_ eq 'journal: crashing before checkpoint', @output);
+pass;
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($dir);
+for (my ($i) = 0; $i < 100; $i += 2) {
+    $dir->{$i} = ["contents of file $i"];
+}
+check_archive ({"j" => $dir});
+pass;
@@ -0,0 +1,59 @@
+/* Creates, writes and removes enough files in one run that the
+   journal commits many transactions, then checks what is left, now
+   and after a reboot. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 100
+
+void
+test_main (void)
+{
+  char name[16], data[32];
+  int i, fd;
+
+  CHECK (mkdir ("j"), "mkdir \"j\"");
+  msg ("create and write %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "j/%d", i);
+      snprintf (data, sizeof data, "contents of file %d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      if (write (fd, data, strlen (data)) != (int) strlen (data))
+        fail ("write \"%s\" failed", name);
+      close (fd);
+    }
+
+  msg ("remove every odd-numbered file");
+  for (i = 1; i < FILE_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "j/%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+
+  msg ("check the rest");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "j/%d", i);
+      fd = open (name);
+      if (i % 2)
+        {
+          if (fd != -1)
+            fail ("\"%s\" was removed but opened as %d", name, fd);
+          continue;
+        }
+      snprintf (data, sizeof data, "contents of file %d", i);
+      quiet = true;
+      check_file (name, data, strlen (data));
+      quiet = false;
+      close (fd);
+    }
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(journal-many) begin
+(journal-many) mkdir "j"
+(journal-many) create and write 100 files
+(journal-many) remove every odd-numbered file
+(journal-many) check the rest
+(journal-many) end
+EOF
+pass;
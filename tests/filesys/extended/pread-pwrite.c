@@ -0,0 +1,45 @@
+/* Writes a file out of order with pwrite, reads parts of it back
+   with pread, and checks that neither moves the file position. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 5678
+static char buf[FILE_SIZE];
+static char part[FILE_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  size_t half = FILE_SIZE / 2;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  CHECK (pwrite (fd, buf + half, FILE_SIZE - half, half)
+         == (int) (FILE_SIZE - half), "pwrite second half");
+  CHECK (pwrite (fd, buf, half, 0) == (int) half, "pwrite first half");
+  CHECK (tell (fd) == 0, "position still 0 after pwrite");
+  CHECK (filesize (fd) == FILE_SIZE, "file size is %d", FILE_SIZE);
+
+  CHECK (pread (fd, part, 1000, 2000) == 1000, "pread 1000 bytes at 2000");
+  compare_bytes (part, buf + 2000, 1000, 2000, file_name);
+  CHECK (pread (fd, part, sizeof part, FILE_SIZE - 10) == 10,
+         "pread across end of file");
+  compare_bytes (part, buf + FILE_SIZE - 10, 10, FILE_SIZE - 10, file_name);
+  CHECK (pread (fd, part, sizeof part, FILE_SIZE + 100) == 0,
+         "pread past end of file");
+  CHECK (pread (fd, part, 10, -1) == -1, "pread at negative offset");
+  CHECK (tell (fd) == 0, "position still 0 after pread");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "testfile"
+(pread-pwrite) open "testfile"
+(pread-pwrite) pwrite second half
+(pread-pwrite) pwrite first half
+(pread-pwrite) position still 0 after pwrite
+(pread-pwrite) file size is 5678
+(pread-pwrite) pread 1000 bytes at 2000
+(pread-pwrite) pread across end of file
+(pread-pwrite) pread past end of file
+(pread-pwrite) pread at negative offset
+(pread-pwrite) position still 0 after pread
+(pread-pwrite) close "testfile"
+(pread-pwrite) open "testfile" for verification
+(pread-pwrite) verified contents of "testfile"
+(pread-pwrite) close "testfile"
+(pread-pwrite) end
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Writes a file from three buffers with one writev, then reads it
+   back into buffers of different sizes with one readv. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 3800
+static char buf[FILE_SIZE];
+static char in[FILE_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  struct iovec out_iov[3] = {
+    { buf, 100 }, { buf + 100, 3000 }, { buf + 3100, 700 },
+  };
+  struct iovec in_iov[3] = {
+    { in, 1900 }, { in + 1900, 1 }, { in + 1901, FILE_SIZE - 1901 },
+  };
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (writev (fd, out_iov, 3) == FILE_SIZE, "writev 3 buffers");
+  CHECK (tell (fd) == FILE_SIZE, "position advanced by writev");
+
+  msg ("seek \"%s\" to 0", file_name);
+  seek (fd, 0);
+  CHECK (readv (fd, in_iov, 3) == FILE_SIZE, "readv 3 buffers");
+  compare_bytes (in, buf, FILE_SIZE, 0, file_name);
+  CHECK (readv (fd, in_iov, 3) == 0, "readv at end of file");
+  CHECK (readv (fd, in_iov, 0) == 0, "readv of no buffers");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
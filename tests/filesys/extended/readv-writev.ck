@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "testfile"
+(readv-writev) open "testfile"
+(readv-writev) writev 3 buffers
+(readv-writev) position advanced by writev
+(readv-writev) seek "testfile" to 0
+(readv-writev) readv 3 buffers
+(readv-writev) readv at end of file
+(readv-writev) readv of no buffers
+(readv-writev) close "testfile"
+(readv-writev) open "testfile" for verification
+(readv-writev) verified contents of "testfile"
+(readv-writev) close "testfile"
+(readv-writev) end
+EOF
+pass;
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($last) = random_bytes (1);
+my ($fill) = random_bytes (3000);
+check_archive ({"testfile" => ["\0" x 50000 . $fill
+			       . "\0" x (102400 - 53000) . $last]});
+pass;
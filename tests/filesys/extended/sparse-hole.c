@@ -0,0 +1,46 @@
+/* Writes one byte far past the end of an empty file and checks that
+   the hole reads as zeros without taking clusters, then fills part
+   of the hole. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HOLE_SIZE 102400
+#define FILL_OFS 50000
+#define FILL_SIZE 3000
+static char buf[HOLE_SIZE + 1];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  struct statfs before, after;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf + HOLE_SIZE, 1);
+  random_bytes (buf + FILL_OFS, FILL_SIZE);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (statfs (&before) == 0, "statfs");
+  msg ("seek \"%s\" to %d", file_name, HOLE_SIZE);
+  seek (fd, HOLE_SIZE);
+  CHECK (write (fd, buf + HOLE_SIZE, 1) == 1, "write 1 byte");
+  CHECK (statfs (&after) == 0, "statfs");
+  if (before.f_bfree - after.f_bfree > 2)
+    fail ("hole took %u clusters", before.f_bfree - after.f_bfree);
+  msg ("hole takes no clusters");
+  CHECK (filesize (fd) == HOLE_SIZE + 1, "file size is %d", HOLE_SIZE + 1);
+
+  msg ("seek \"%s\" to %d", file_name, FILL_OFS);
+  seek (fd, FILL_OFS);
+  CHECK (write (fd, buf + FILL_OFS, FILL_SIZE) == FILL_SIZE,
+         "write %d bytes into the hole", FILL_SIZE);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sparse-hole) begin
+(sparse-hole) create "testfile"
+(sparse-hole) open "testfile"
+(sparse-hole) statfs
+(sparse-hole) seek "testfile" to 102400
+(sparse-hole) write 1 byte
+(sparse-hole) statfs
+(sparse-hole) hole takes no clusters
+(sparse-hole) file size is 102401
+(sparse-hole) seek "testfile" to 50000
+(sparse-hole) write 3000 bytes into the hole
+(sparse-hole) close "testfile"
+(sparse-hole) open "testfile" for verification
+(sparse-hole) verified contents of "testfile"
+(sparse-hole) close "testfile"
+(sparse-hole) end
+EOF
+pass;
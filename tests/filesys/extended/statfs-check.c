@@ -0,0 +1,32 @@
+/* Run by the persistence check of statfs after a reboot.  Compares
+   statfs's counts with those statfs saved in "counts" before the
+   reboot, then removes "counts".  Prints nothing unless they
+   differ. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "statfs-check";
+
+int
+main (void)
+{
+  struct statfs saved, st;
+  int fd;
+
+  quiet = true;
+  CHECK ((fd = open ("counts")) > 1, "open \"counts\"");
+  CHECK (read (fd, &saved, sizeof saved) == (int) sizeof saved,
+         "read \"counts\"");
+  close (fd);
+
+  CHECK (statfs (&st) == 0, "statfs");
+  if (st.f_bfree != saved.f_bfree)
+    fail ("%u clusters free after reboot, %u before",
+          st.f_bfree, saved.f_bfree);
+  if (st.f_inodes != saved.f_inodes)
+    fail ("%u inodes in use after reboot, %u before",
+          st.f_inodes, saved.f_inodes);
+  CHECK (remove ("counts"), "remove \"counts\"");
+  return 0;
+}
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({"statfs-check" => "tests/filesys/extended/statfs-check"});
+pass;
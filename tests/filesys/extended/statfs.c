@@ -0,0 +1,56 @@
+/* Checks that statfs's free cluster and inode counts follow files
+   being created, grown and removed, then saves the counts for
+   statfs-check to compare against after a reboot. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CLUSTERS 10
+static char block[512];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  struct statfs s0, s1, s2, s3, st;
+  size_t ofs, size;
+  int fd;
+
+  CHECK (statfs (&s0) == 0, "statfs");
+  if (s0.f_bsize == 0 || s0.f_bsize % sizeof block != 0)
+    fail ("bad cluster size %u", s0.f_bsize);
+  if (s0.f_bfree > s0.f_blocks)
+    fail ("%u clusters free of %u", s0.f_bfree, s0.f_blocks);
+  msg ("counts are sane");
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK (statfs (&s1) == 0, "statfs");
+  CHECK (s1.f_inodes == s0.f_inodes + 1, "one more inode in use");
+
+  size = CLUSTERS * s1.f_bsize;
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (ofs = 0; ofs < size; ofs += sizeof block)
+    if (write (fd, block, sizeof block) != (int) sizeof block)
+      fail ("write %zu bytes at offset %zu failed", sizeof block, ofs);
+  msg ("write %d clusters", CLUSTERS);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (statfs (&s2) == 0, "statfs");
+  if (s1.f_bfree - s2.f_bfree < CLUSTERS)
+    fail ("only %u fewer clusters free", s1.f_bfree - s2.f_bfree);
+  msg ("at least %d fewer clusters free", CLUSTERS);
+
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+  CHECK (statfs (&s3) == 0, "statfs");
+  CHECK (s3.f_inodes == s0.f_inodes, "inode count restored");
+  CHECK (s3.f_bfree == s1.f_bfree + 1, "free cluster count restored");
+
+  /* Small enough to stay inline, so writing it takes no clusters. */
+  CHECK (create ("counts", 0), "create \"counts\"");
+  CHECK ((fd = open ("counts")) > 1, "open \"counts\"");
+  CHECK (statfs (&st) == 0, "statfs");
+  CHECK (write (fd, &st, sizeof st) == (int) sizeof st, "write \"counts\"");
+  msg ("close \"counts\"");
+  close (fd);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(statfs) begin
+(statfs) statfs
+(statfs) counts are sane
+(statfs) create "testfile"
+(statfs) statfs
+(statfs) one more inode in use
+(statfs) open "testfile"
+(statfs) write 10 clusters
+(statfs) close "testfile"
+(statfs) statfs
+(statfs) at least 10 fewer clusters free
+(statfs) remove "testfile"
+(statfs) statfs
+(statfs) inode count restored
+(statfs) free cluster count restored
+(statfs) create "counts"
+(statfs) open "counts"
+(statfs) statfs
+(statfs) write "counts"
+(statfs) close "counts"
+(statfs) end
+EOF
+pass;
@@ -36,6 +36,8 @@
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/fat.h"
+#include "filesys/journal.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -214,8 +216,28 @@ parse_options (char **argv) {
 		else if (!strcmp (name, "-q"))
 			power_off_when_done = true;
 #ifdef FILESYS
-		else if (!strcmp (name, "-f"))
+		else if (!strcmp (name, "-f")) {
 			format_filesys = true;
+#ifdef EFILESYS
+			if (value != NULL) {
+				int spc = atoi (value);
+				if (spc < 1 || spc > MAX_SECTORS_PER_CLUSTER)
+					PANIC ("cluster size must be 1 to %d sectors",
+							MAX_SECTORS_PER_CLUSTER);
+				fat_format_cluster_size = spc;
+			}
+#endif
+		}
+		else if (!strcmp (name, "-disk-stats"))
+			disk_detailed_stats = true;
+		else if (!strcmp (name, "-stripe"))
+			filesys_striped = true;
+#ifdef EFILESYS
+		else if (!strcmp (name, "-fat-ordered"))
+			fat_ordered_writes = true;
+		else if (!strcmp (name, "-journal-crash"))
+			journal_crash = true;
+#endif
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
@@ -272,6 +294,7 @@ run_actions (char **argv) {
 		{"rm", 2, fsutil_rm},
 		{"put", 2, fsutil_put},
 		{"get", 2, fsutil_get},
+		{"defrag", 1, fsutil_defrag},
 #endif
 		{NULL, 0, NULL},
 	};
@@ -316,6 +339,7 @@ usage (void) {
 			"  ls                 List files in the root directory.\n"
 			"  cat FILE           Print FILE to the console.\n"
 			"  rm FILE            Delete FILE.\n"
+			"  defrag             Move every file into contiguous clusters.\n"
 			"Use these actions indirectly via `pintos' -g and -p options:\n"
 			"  put FILE           Put FILE into file system from scratch disk.\n"
 			"  get FILE           Get FILE from file system into scratch disk.\n"
@@ -324,6 +348,13 @@ usage (void) {
 			"  -h                 Print this help message and power off.\n"
 			"  -q                 Power off VM after actions or on panic.\n"
 			"  -f                 Format file system disk during startup.\n"
+			"  -disk-stats        Print disk latencies and trace on shutdown.\n"
+			"  -stripe            Stripe file system over hd0:1 and hd1:0.\n"
+#ifdef EFILESYS
+			"  -f=N               Same, with clusters of N sectors (1 to 64).\n"
+			"  -fat-ordered       Write FAT updates through before returning.\n"
+			"  -journal-crash     Power off at the commit point of sync().\n"
+#endif
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
@@ -341,7 +372,13 @@ power_off (void) {
 #ifdef FILESYS
 	filesys_done ();
 #endif
+	power_off_unflushed ();
+}
 
+/* Powers down the machine without writing back file system state,
+   leaving the disks as a crash at this point would. */
+void
+power_off_unflushed (void) {
 	print_stats ();
 
 	printf ("Powering off...\n");
@@ -366,3 +366,92 @@ bool cmp_sem_priority(struct list_elem *e1, struct list_elem *e2){
 	struct semaphore_elem *s2 = list_entry(e2, struct semaphore_elem, elem);
 	return s1->priority > s2->priority;
 }
+
+/* Initializes RW, a readers-writer lock, to be held by nobody. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->lock);
+	cond_init (&rw->readers_ok);
+	cond_init (&rw->writers_ok);
+	rw->readers = 0;
+	rw->waiting_writers = 0;
+	rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds or is
+   waiting for it.  RW must not already be held by the current
+   thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != thread_current ());
+
+	lock_acquire (&rw->lock);
+	while (rw->writer != NULL || rw->waiting_writers > 0)
+		cond_wait (&rw->readers_ok, &rw->lock);
+	rw->readers++;
+	lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_acquire (&rw->lock);
+	ASSERT (rw->readers > 0);
+	if (--rw->readers == 0)
+		cond_signal (&rw->writers_ok, &rw->lock);
+	lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  RW must not already be held by the current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != thread_current ());
+
+	lock_acquire (&rw->lock);
+	rw->waiting_writers++;
+	while (rw->writer != NULL || rw->readers > 0)
+		cond_wait (&rw->writers_ok, &rw->lock);
+	rw->waiting_writers--;
+	rw->writer = thread_current ();
+	lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing.
+   Hands the lock to the next writer if one is waiting, otherwise
+   lets all waiting readers in. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_acquire (&rw->lock);
+	ASSERT (rw->writer == thread_current ());
+	rw->writer = NULL;
+	if (rw->waiting_writers > 0)
+		cond_signal (&rw->writers_ok, &rw->lock);
+	else
+		cond_broadcast (&rw->readers_ok, &rw->lock);
+	lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return rw->writer == thread_current ();
+}
@@ -474,9 +474,7 @@ load (const char *file_name, struct intr_frame *if_) {
 
 	/* Open executable file. */
 	/* 프로그램 파일 open*/
-	lock_acquire(&filesys_lock);
 	file = filesys_open (file_name);
-	lock_release(&filesys_lock);
 	if (file == NULL) {
 		printf ("load: %s: open failed\n", file_name);
 		exit(-1);
@@ -487,9 +485,7 @@ load (const char *file_name, struct intr_frame *if_) {
 
 	/* Read and verify executable header. */
 	/* ELF파일의 헤더정보를 읽어와 저장 */
-	lock_acquire(&filesys_lock);
 	off_t oft = file_read (file, &ehdr, sizeof ehdr);
-	lock_release(&filesys_lock);
 	if (oft != sizeof ehdr
 			|| memcmp (ehdr.e_ident, "\177ELF\2\1\1", 7)
 			|| ehdr.e_type != 2
@@ -509,9 +505,7 @@ load (const char *file_name, struct intr_frame *if_) {
 			goto done;
 		file_seek (file, file_ofs);
 
-		lock_acquire(&filesys_lock);
 		oft = file_read (file, &phdr, sizeof phdr);
-		lock_release(&filesys_lock);
 
 		if (oft != sizeof phdr){
 			goto done;
@@ -795,9 +789,6 @@ lazy_load_segment (struct page *page, void *aux) {
 	
 	file_seek(fp->file, fp->ofs);
 	
-	// if (!lock_held_by_current_thread(&filesys_lock)){
-	// 	lock_acquire(&filesys_lock);
-	// }
 	/* Load this page. */
 	off_t t = file_read (fp->file, page->frame->kva, fp->page_read_byte);
 
@@ -13,6 +13,8 @@
 #include "threads/synch.h"
 #include "lib/string.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
+#include <uio.h>
 
 /*Project 3*/
 #include "include/vm/vm.h"
@@ -62,6 +64,19 @@ bool sys_mkdir(const char *dir);
 bool sys_readdir(int fd, char *name);
 cluster_t sys_inumber(int fd);
 
+int sys_pread(int fd, void *buffer, unsigned size, off_t offset);
+int sys_pwrite(int fd, const void *buffer, unsigned size, off_t offset);
+int sys_readv(int fd, const struct iovec *iov, int iovcnt, void *rsp);
+int sys_writev(int fd, const struct iovec *iov, int iovcnt, void *rsp);
+int sys_copy_file_range(int fd_in, int fd_out, unsigned length);
+int sys_fsync(int fd);
+int sys_fdatasync(int fd);
+void sys_sync(void);
+int sys_fallocate(int fd, off_t offset, off_t len);
+int sys_defrag(int fd);
+int sys_getdents(int fd, struct dirent *buf, unsigned size);
+int sys_statfs(struct statfs *buf);
+
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -79,7 +94,6 @@ cluster_t sys_inumber(int fd);
 
 void syscall_init(void)
 {
-	lock_init(&filesys_lock);
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48 |
 							((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t)syscall_entry);
@@ -169,6 +183,46 @@ void syscall_handler(struct intr_frame *f UNUSED)
 	case SYS_INUMBER:
 		f->R.rax = sys_inumber(f->R.rdi);
 		break;
+	case SYS_PREAD:
+		check_valid_buffer(f->R.rsi, f->R.rdx, f->rsp, 1);
+		f->R.rax = sys_pread(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+		break;
+	case SYS_PWRITE:
+		check_valid_buffer(f->R.rsi, f->R.rdx, f->rsp, 0);
+		f->R.rax = sys_pwrite(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+		break;
+	case SYS_READV:
+		f->R.rax = sys_readv(f->R.rdi, f->R.rsi, f->R.rdx, f->rsp);
+		break;
+	case SYS_WRITEV:
+		f->R.rax = sys_writev(f->R.rdi, f->R.rsi, f->R.rdx, f->rsp);
+		break;
+	case SYS_COPY_FILE_RANGE:
+		f->R.rax = sys_copy_file_range(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_FSYNC:
+		f->R.rax = sys_fsync(f->R.rdi);
+		break;
+	case SYS_FDATASYNC:
+		f->R.rax = sys_fdatasync(f->R.rdi);
+		break;
+	case SYS_SYNC:
+		sys_sync();
+		break;
+	case SYS_FALLOCATE:
+		f->R.rax = sys_fallocate(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_DEFRAG:
+		f->R.rax = sys_defrag(f->R.rdi);
+		break;
+	case SYS_GETDENTS:
+		check_valid_buffer(f->R.rsi, f->R.rdx, f->rsp, 1);
+		f->R.rax = sys_getdents(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_STATFS:
+		check_valid_buffer(f->R.rdi, sizeof(struct statfs), f->rsp, 1);
+		f->R.rax = sys_statfs(f->R.rdi);
+		break;
 	default:
 		thread_exit();
 		break;
@@ -237,10 +291,7 @@ bool sys_chdir(const char *path_name) {
 }
 
 bool sys_mkdir(const char *dir) {
-    lock_acquire(&lock);
-    bool new_dir = filesys_create_dir(dir);
-    lock_release(&lock);
-    return new_dir;
+    return filesys_create_dir(dir);
 }
 bool sys_readdir(int fd, char *name) {
     if (name == NULL) {
@@ -270,6 +321,41 @@ bool sys_readdir(int fd, char *name) {
     return result;
 }
 
+/* Fills BUF with as many entries of directory FD, after "." and "..",
+ * as fit in SIZE bytes.  Returns the number of bytes filled, 0 at the
+ * end of the directory, or -1 if FD is not a directory. */
+int sys_getdents(int fd, struct dirent *buf, unsigned size)
+{
+	struct file *file = find_file(fd);
+	struct dir *dir;
+
+	if (file <= 2 || !inode_is_dir(file_get_inode(file)))
+		return -1;
+
+	/* Directories share struct file's inode and position, as in
+	 * sys_readdir(). */
+	dir = (struct dir *) file;
+	if (dir->pos == 0)
+		dir_seek(dir, 2 * sizeof(struct dir_entry));
+	return dir_getdents(dir, buf, size / sizeof *buf) * sizeof *buf;
+}
+
+/* Stores the file system's size and usage in BUF.  The counters are
+ * copied out after fat_statfs() returns, so a page fault on BUF is
+ * never taken with the FAT locked. */
+int sys_statfs(struct statfs *buf)
+{
+#ifdef EFILESYS
+	struct statfs st;
+
+	fat_statfs(&st);
+	memcpy(buf, &st, sizeof st);
+	return 0;
+#else
+	(void) buf;
+	return -1;
+#endif
+}
 
 cluster_t sys_inumber(int fd)
 {
@@ -284,8 +370,16 @@ cluster_t sys_inumber(int fd)
 
 void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write) {
 	// printf("======check valid buffer\n");
-    for (int i = 0; i < size; i++) {
-        struct page* page = check_address2(buffer + i);    // 인자로 받은 buffer부터 buffer + size까지의 크기가 한 페이지의 크기를 넘을수도 있음
+	if (size == 0)
+		return;
+
+	/* Validity is a property of whole pages, so one lookup per page
+	 * the buffer touches is enough. */
+	uint8_t *end = (uint8_t *) buffer + size;
+	if (end < (uint8_t *) buffer)
+		exit(-1);	/* Wraps past the top of the address space. */
+    for (uint8_t *p = pg_round_down(buffer); p < end; p += PGSIZE) {
+        struct page* page = check_address2(p);    // 인자로 받은 buffer부터 buffer + size까지의 크기가 한 페이지의 크기를 넘을수도 있음
         if(page == NULL)
             exit(-1);
         if(to_write == true && page->writable == false)
@@ -293,6 +387,174 @@ void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write) {
     }
 }
 
+/* Copies the IOVCNT-entry iovec array at user address IOV into the
+ * kernel and validates every buffer it names, up front, so the
+ * transfer itself runs without further checks.  Terminates the
+ * process on a bad address.  Returns a null pointer if IOVCNT is out
+ * of range, the total length does not fit in an int, or memory runs
+ * out; the caller frees the copy. */
+static struct iovec *
+copy_in_iovec(const struct iovec *iov, int iovcnt, void *rsp, bool to_write)
+{
+	struct iovec *kiov;
+	size_t total = 0;
+
+	if (iovcnt <= 0 || iovcnt > IOV_MAX)
+		return NULL;
+	check_valid_buffer((void *) iov, iovcnt * sizeof *iov, rsp, false);
+
+	kiov = malloc(iovcnt * sizeof *kiov);
+	if (kiov == NULL)
+		return NULL;
+	memcpy(kiov, iov, iovcnt * sizeof *kiov);
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		total += kiov[i].iov_len;
+		if (kiov[i].iov_len > INT32_MAX || total > INT32_MAX)
+		{
+			free(kiov);
+			return NULL;
+		}
+		check_valid_buffer(kiov[i].iov_base, kiov[i].iov_len, rsp, to_write);
+	}
+	return kiov;
+}
+
+/* Copies LENGTH bytes from FD_IN to FD_OUT, at and advancing each
+ * descriptor's position, without passing the data through user
+ * memory. */
+int sys_copy_file_range(int fd_in, int fd_out, unsigned length)
+{
+	struct file *in = find_file(fd_in);
+	struct file *out = find_file(fd_out);
+
+	if (in <= 2 || out <= 2 || inode_is_dir(file_get_inode(in)))
+		return -1;
+	if (length > INT32_MAX)
+		length = INT32_MAX;
+	return file_copy_range(in, out, length);
+}
+
+/* Makes everything written to FD so far durable. */
+int sys_fsync(int fd)
+{
+	struct file *file = find_file(fd);
+
+	if (file <= 2)
+		return -1;
+	file_sync(file);
+	return 0;
+}
+
+/* Makes FD's data, and the metadata needed to read it back, durable.
+ * Every piece of inode metadata kept here (length, extents, inline
+ * data) is needed to read the data back, so this is fsync(). */
+int sys_fdatasync(int fd)
+{
+	return sys_fsync(fd);
+}
+
+/* Writes all pending file system metadata to disk. */
+void sys_sync(void)
+{
+	filesys_sync();
+}
+
+/* Reserves contiguous disk space for LEN bytes of FD at OFFSET. */
+int sys_fallocate(int fd, off_t offset, off_t len)
+{
+	struct file *file = find_file(fd);
+
+	if (file <= 2 || offset < 0 || len <= 0 || offset > INT32_MAX - len)
+		return -1;
+	return file_allocate(file, offset, len) ? 0 : -1;
+}
+
+/* Moves FD's data into contiguous clusters.  Returns the number of
+ * fragments it had before, or -1 if there was no room to move it. */
+int sys_defrag(int fd)
+{
+	struct file *file = find_file(fd);
+	size_t before, after;
+
+	if (file <= 2 || !file_defrag(file, &before, &after))
+		return -1;
+	return before;
+}
+
+/* Reads from FD at OFFSET without using or moving its position. */
+int sys_pread(int fd, void *buffer, unsigned size, off_t offset)
+{
+	struct file *file = find_file(fd);
+
+	if (file <= 2 || offset < 0)
+		return -1;
+	return file_read_at(file, buffer, size, offset);
+}
+
+/* Writes to FD at OFFSET without using or moving its position. */
+int sys_pwrite(int fd, const void *buffer, unsigned size, off_t offset)
+{
+	struct file *file = find_file(fd);
+
+	if (file <= 2 || offset < 0 || inode_is_dir(file_get_inode(file)))
+		return -1;
+	return file_write_at(file, buffer, size, offset);
+}
+
+/* Reads from FD into each buffer of IOV in turn. */
+int sys_readv(int fd, const struct iovec *iov, int iovcnt, void *rsp)
+{
+	struct file *file = find_file(fd);
+	struct iovec *kiov;
+	int bytes_read = 0;
+
+	if (file == NULL || file == STDOUT)
+		return -1;
+	if (iovcnt == 0)
+		return 0;
+	kiov = copy_in_iovec(iov, iovcnt, rsp, true);
+	if (kiov == NULL)
+		return -1;
+
+	if (file == STDIN)
+	{
+		for (int i = 0; i < iovcnt; i++)
+			bytes_read += read(fd, kiov[i].iov_base, kiov[i].iov_len);
+	}
+	else
+		bytes_read = file_readv(file, kiov, iovcnt);
+	free(kiov);
+	return bytes_read;
+}
+
+/* Writes each buffer of IOV in turn to FD. */
+int sys_writev(int fd, const struct iovec *iov, int iovcnt, void *rsp)
+{
+	struct file *file = find_file(fd);
+	struct iovec *kiov;
+	int bytes_written = 0;
+
+	if (file == NULL || file == STDIN)
+		return -1;
+	if (iovcnt == 0)
+		return 0;
+	kiov = copy_in_iovec(iov, iovcnt, rsp, false);
+	if (kiov == NULL)
+		return -1;
+
+	if (file == STDOUT)
+	{
+		for (int i = 0; i < iovcnt; i++)
+			bytes_written += write(fd, kiov[i].iov_base, kiov[i].iov_len);
+	}
+	else
+		bytes_written = file_writev(file, kiov, iovcnt);
+	free(kiov);
+	return bytes_written;
+}
+
 struct page * check_address2(void *addr) {
     if (is_kernel_vaddr(addr))
     {
@@ -391,10 +653,7 @@ void exit(int status)
 bool create(const char *file, unsigned initial_size)
 {
 	check_address(file);
-	lock_acquire(&filesys_lock);
-	bool t = filesys_create(file, initial_size);
-	lock_release(&filesys_lock);
-	return t;
+	return filesys_create(file, initial_size);
 }
 
 /* Project2-3 System Call */
@@ -427,9 +686,7 @@ int exec(const char *cmd_line)
 int open(const char *file)
 {
 	check_address(file);
-	lock_acquire(&filesys_lock);
 	struct file *fileobj = filesys_open(file);
-	lock_release(&filesys_lock);
 
 	if (fileobj == NULL)
 	{
@@ -520,13 +777,7 @@ int read(int fd, void *buffer, unsigned size)
 	}
 	else
 	{
-		// if (!lock_held_by_current_thread(&filesys_lock)){
-		// 	lock_acquire(&filesys_lock);
-		// }
-		lock_acquire(&filesys_lock);
 		char_count = file_read(file, buffer, size);
-		lock_release(&filesys_lock);
-		
 	}
 	return char_count;
 }
@@ -561,9 +812,7 @@ int write(int fd, const void *buffer, unsigned size)
 	}
 	else
 	{
-		lock_acquire(&filesys_lock);
 		write_size = file_write(file, buffer, size);
-		lock_release(&filesys_lock);
 	}
 	return write_size;
 }
@@ -61,8 +61,8 @@ anon_swap_in(struct page *page, void *kva)
 		return false;
 	}
 
-	for (int j = 0; j < SECTORS_PER_PAGE; j++)
-		disk_read(swap_disk, i * SECTORS_PER_PAGE + j, kva + DISK_SECTOR_SIZE * j);
+	/* 한 페이지의 섹터들은 연속되어 있으므로 한 번의 명령으로 읽는다. */
+	disk_read_multi(swap_disk, i * SECTORS_PER_PAGE, SECTORS_PER_PAGE, kva);
 	
 	// if (install_page(page->va,kva,page->writable))
 	// 	return true;
@@ -90,9 +90,8 @@ anon_swap_out(struct page *page)
 	// page->frame->page= NULL;
 	// page->frame = NULL;
 
-	for (int j = 0; j < SECTORS_PER_PAGE; j++) {
-		disk_write(swap_disk, i * SECTORS_PER_PAGE + j, page->va + DISK_SECTOR_SIZE * j);
-	}
+	/* 사용자 주소 대신 프레임의 커널 주소를 넘겨야 DMA로 보낼 수 있다. */
+	disk_write_multi(swap_disk, i * SECTORS_PER_PAGE, SECTORS_PER_PAGE, page->frame->kva);
 	bitmap_set(swap_table, i, true);
 	pml4_clear_page(thread_current()->pml4, page->va);
 	anon_page->idx = i;